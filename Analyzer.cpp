@@ -0,0 +1,385 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "Analyzer.h"
+#include "RomLoader.h"
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+
+namespace {
+
+constexpr uint16_t FONT_ADDRESS = 0x050;
+constexpr uint16_t BIG_FONT_ADDRESS = 0x0A0;
+
+struct Decoder {
+    const std::vector<uint8_t> &memory;
+    const Chip8 &machine;
+
+    uint16_t word(uint16_t address) const {
+        return (memory[address] << 8) | memory[static_cast<uint16_t>(address + 1)];
+    }
+    Instruction instruction(uint16_t address) const { return machine.decode(word(address)); }
+    Op op(uint16_t address) const { return machine.decodeOp(instruction(address)); }
+    int length(uint16_t address) const { return opInfo(op(address)).length; }
+};
+
+// Addresses and sizes are 16-bit, ranges are merged and sorted
+std::vector<MemoryRegion> mergeRegions(std::vector<MemoryRegion> regions) {
+    std::sort(regions.begin(), regions.end(),
+              [](const MemoryRegion &a, const MemoryRegion &b) { return a.start < b.start; });
+    std::vector<MemoryRegion> merged;
+    for (const MemoryRegion &region : regions) {
+        if (!merged.empty() && region.start <= merged.back().start + merged.back().length) {
+            uint32_t end = std::max<uint32_t>(merged.back().start + merged.back().length,
+                                              region.start + region.length);
+            merged.back().length = static_cast<uint16_t>(end - merged.back().start);
+        } else {
+            merged.push_back(region);
+        }
+    }
+    return merged;
+}
+
+std::string hex(uint32_t value, int width = 3) {
+    std::stringstream ss;
+    ss << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(width) << value;
+    return ss.str();
+}
+
+// Disassembly of each instruction of a block, as (address, text)
+std::vector<std::pair<uint16_t, std::string>> blockListing(const Analysis &analysis, const BasicBlock &block,
+                                                           Chip8 &machine) {
+    Decoder decoder{analysis.memory, machine};
+    std::vector<std::pair<uint16_t, std::string>> listing;
+    for (uint32_t pc = block.start; pc < block.end;) {
+        Instruction i = decoder.instruction(static_cast<uint16_t>(pc));
+        std::string text = machine.disassemble(i);
+        if (machine.decodeOp(i) == Op::LongI) {
+            text += " " + hex(decoder.word(static_cast<uint16_t>(pc + 2)), 4);
+        }
+        listing.emplace_back(static_cast<uint16_t>(pc), text);
+        pc += opInfo(machine.decodeOp(i)).length;
+    }
+    return listing;
+}
+
+std::string escape(const std::string &text) {
+    std::string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+}
+
+bool Analysis::isCode(uint16_t address) const {
+    auto it = blocks.upper_bound(address);
+    if (it == blocks.begin()) {
+        return false;
+    }
+    --it;
+    return address < it->second.end;
+}
+
+bool Analysis::isPrecompilable(uint16_t address) const {
+    auto it = blocks.upper_bound(address);
+    if (it == blocks.begin()) {
+        return false;
+    }
+    --it;
+    return address < it->second.end && it->second.precompilable;
+}
+
+Analysis analyzeROM(const uint8_t *data, size_t size, Mode mode) {
+    std::unique_ptr<Chip8> machine = createMachine(mode);
+    uint32_t memorySize = machine->memorySize();
+    if (size > memorySize - 0x200) {
+        throw std::runtime_error("ROM size exceeds memory capacity");
+    }
+
+    Analysis analysis;
+    analysis.mode = mode;
+    analysis.memory.assign(0x10000, 0);
+    std::copy_n(data, size, analysis.memory.begin() + 0x200);
+    Decoder decoder{analysis.memory, *machine};
+
+    analysis.romEnd = static_cast<uint16_t>(0x200 + size);
+
+    // Pass 1: discover reachable instructions and block leaders, tracking I where it is constant
+    std::set<uint16_t> leaders{0x200};
+    std::set<uint16_t> visited; // Reachable instruction addresses
+    std::vector<std::pair<uint16_t, std::optional<uint16_t>>> worklist{{0x200, std::nullopt}};
+    std::vector<MemoryRegion> sprites;
+    std::vector<MemoryWrite> writes;
+    uint8_t planes = 1;
+
+    while (!worklist.empty()) {
+        auto [pc, indexValue] = worklist.back();
+        worklist.pop_back();
+
+        while (pc < memorySize - 1 && !visited.count(pc)) {
+            visited.insert(pc);
+            Instruction i = decoder.instruction(pc);
+            Op op = machine->decodeOp(i);
+            const OpInfo &info = opInfo(op);
+            uint32_t next = pc + info.length; // Code does not run past the end of memory
+
+            // Record the memory each instruction touches through I
+            if (op == Op::Draw || op == Op::DrawBig) {
+                if (indexValue && *indexValue >= 0x200) {
+                    int bytes = (op == Op::DrawBig ? 32 : i.n) * std::max(1, std::popcount(planes));
+                    sprites.push_back({*indexValue, static_cast<uint16_t>(bytes)});
+                }
+            } else if (info.flags & F_WRITES_MEMORY) {
+                uint16_t length = op == Op::Bcd ? 3 : op == Op::SaveRange ? std::abs(i.y - i.x) + 1 : i.x + 1;
+                if (indexValue) {
+                    writes.push_back({pc, *indexValue, length});
+                } else {
+                    analysis.unknownWrites.push_back(pc);
+                }
+            }
+
+            // Track the index register
+            switch (op) {
+                case Op::LoadI: indexValue = i.nnn; break;
+                case Op::LongI: indexValue = decoder.word(static_cast<uint16_t>(pc + 2)); break;
+                case Op::Font: indexValue = FONT_ADDRESS; break; // Digit unknown, any font glyph
+                case Op::BigFont: indexValue = BIG_FONT_ADDRESS; break;
+                case Op::Plane: planes = i.x & 0x3; break;
+                default:
+                    if (info.flags & F_WRITES_I) {
+                        indexValue.reset(); // FX1E, or FX55/FX65 depending on the memory quirk
+                    }
+                    break;
+            }
+
+            // Follow control flow
+            if (op == Op::Invalid || (op == Op::Sys && i.nnn == 0)) {
+                break; // Ran into data
+            }
+            if ((info.flags & F_SKIP) && next < memorySize) {
+                uint32_t skipTo = next + decoder.length(static_cast<uint16_t>(next));
+                leaders.insert(static_cast<uint16_t>(next));
+                if (skipTo < memorySize) {
+                    leaders.insert(static_cast<uint16_t>(skipTo));
+                    worklist.push_back({static_cast<uint16_t>(skipTo), indexValue});
+                }
+            }
+            if (op == Op::Jump) {
+                leaders.insert(i.nnn);
+                worklist.push_back({i.nnn, indexValue});
+                break;
+            }
+            if (op == Op::Call) {
+                analysis.subroutines.insert(i.nnn);
+                leaders.insert(i.nnn);
+                if (next < memorySize) {
+                    leaders.insert(static_cast<uint16_t>(next));
+                }
+                worklist.push_back({i.nnn, indexValue});
+                indexValue.reset(); // The subroutine may change I
+            }
+            if (op == Op::Ret || op == Op::JumpOffset || op == Op::Exit || next >= memorySize) {
+                break;
+            }
+            pc = static_cast<uint16_t>(next);
+        }
+    }
+
+    // Pass 2: split the reachable instructions into basic blocks
+    for (auto it = visited.begin(); it != visited.end();) {
+        uint16_t start = *it;
+        BasicBlock block{start, start, {}};
+        uint32_t pc = start;
+        while (true) {
+            Instruction i = decoder.instruction(static_cast<uint16_t>(pc));
+            Op op = machine->decodeOp(i);
+            const OpInfo &info = opInfo(op);
+            uint32_t next = pc + info.length;
+            block.end = std::min(next, memorySize);
+            // Successors past the end of memory are not code
+            auto add = [&](uint32_t successor) {
+                if (successor < memorySize) {
+                    block.successors.push_back(static_cast<uint16_t>(successor));
+                }
+            };
+
+            bool terminator = true;
+            if (op == Op::Invalid || (op == Op::Sys && i.nnn == 0) || op == Op::Ret || op == Op::Exit) {
+                // No successors
+            } else if (op == Op::Jump) {
+                add(i.nnn);
+            } else if (op == Op::JumpOffset) {
+                block.indirect = true;
+            } else if (op == Op::Call) {
+                add(i.nnn);
+                add(next);
+            } else if (info.flags & F_SKIP) {
+                add(next);
+                if (next < memorySize) {
+                    add(next + decoder.length(static_cast<uint16_t>(next)));
+                }
+            } else if (next >= memorySize || leaders.count(next) || !visited.count(next)) {
+                if (next < memorySize && visited.count(next)) {
+                    add(next);
+                }
+            } else {
+                terminator = false;
+            }
+            if (terminator) {
+                break;
+            }
+            pc = next;
+        }
+        analysis.blocks[start] = block;
+        // Blocks end after they start, so the scan only moves forward and stops at the end of memory
+        it = block.end < memorySize ? visited.lower_bound(static_cast<uint16_t>(block.end)) : visited.end();
+    }
+
+    // Pass 3: classify stores and data
+    analysis.sprites = mergeRegions(sprites);
+    for (const MemoryWrite &write : writes) {
+        bool intoCode = false;
+        for (uint32_t a = write.target; a < uint32_t(write.target) + write.length; a++) {
+            if (analysis.isCode(static_cast<uint16_t>(a))) {
+                intoCode = true;
+                for (auto &[start, block] : analysis.blocks) {
+                    if (a >= start && a < block.end) {
+                        block.selfModified = true;
+                    }
+                }
+            }
+        }
+        if (intoCode) {
+            analysis.selfModifyingWrites.push_back(write);
+        }
+    }
+    // A store through an unknown I can land in any block, so none is safe once there is one
+    for (auto &[start, block] : analysis.blocks) {
+        block.precompilable = !block.selfModified && analysis.unknownWrites.empty();
+    }
+
+    // Pass 4: everything in the ROM that is neither code nor sprite data
+    std::vector<bool> covered(0x10000, false);
+    for (const auto &[start, block] : analysis.blocks) {
+        std::fill(covered.begin() + start, covered.begin() + block.end, true);
+    }
+    for (const MemoryRegion &sprite : analysis.sprites) {
+        std::fill(covered.begin() + sprite.start,
+                  covered.begin() + std::min<uint32_t>(sprite.start + sprite.length, 0x10000), true);
+    }
+    for (uint32_t a = analysis.romStart; a < analysis.romEnd;) {
+        if (covered[a]) {
+            a++;
+            continue;
+        }
+        uint32_t end = a;
+        while (end < analysis.romEnd && !covered[end]) {
+            end++;
+        }
+        // Dead code when every aligned word of the gap decodes for this platform
+        bool valid = (end - a) >= 2;
+        for (uint32_t w = a; valid && w + 1 < end; w += 2) {
+            valid = decoder.op(static_cast<uint16_t>(w)) != Op::Invalid;
+        }
+        MemoryRegion region{static_cast<uint16_t>(a), static_cast<uint16_t>(end - a)};
+        (valid ? analysis.deadCode : analysis.unknownData).push_back(region);
+        a = end;
+    }
+
+    return analysis;
+}
+
+std::string analysisToJSON(const Analysis &analysis) {
+    std::unique_ptr<Chip8> machine = createMachine(analysis.mode);
+    std::stringstream out;
+    auto regions = [&](const std::vector<MemoryRegion> &list) {
+        out << "[";
+        for (size_t k = 0; k < list.size(); k++) {
+            out << (k ? ", " : "") << "{\"start\": " << list[k].start << ", \"length\": " << list[k].length << "}";
+        }
+        out << "]";
+    };
+
+    out << "{\n";
+    out << "  \"platform\": \"" << modeName(analysis.mode) << "\",\n";
+    out << "  \"rom\": {\"start\": " << analysis.romStart << ", \"end\": " << analysis.romEnd << "},\n";
+    out << "  \"blocks\": [\n";
+    size_t n = 0;
+    for (const auto &[start, block] : analysis.blocks) {
+        out << "    {\"start\": " << start << ", \"end\": " << block.end
+            << ", \"subroutine\": " << (analysis.subroutines.count(start) ? "true" : "false")
+            << ", \"indirect\": " << (block.indirect ? "true" : "false")
+            << ", \"selfModified\": " << (block.selfModified ? "true" : "false")
+            << ", \"precompilable\": " << (block.precompilable ? "true" : "false")
+            << ", \"successors\": [";
+        for (size_t k = 0; k < block.successors.size(); k++) {
+            out << (k ? ", " : "") << block.successors[k];
+        }
+        out << "], \"instructions\": [";
+        size_t k = 0;
+        for (const auto &[address, text] : blockListing(analysis, block, *machine)) {
+            out << (k++ ? ", " : "") << "{\"address\": " << address << ", \"text\": \"" << escape(text) << "\"}";
+        }
+        out << "]}" << (++n < analysis.blocks.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"subroutines\": [";
+    n = 0;
+    for (uint16_t entry : analysis.subroutines) {
+        out << (n++ ? ", " : "") << entry;
+    }
+    out << "],\n  \"sprites\": ";
+    regions(analysis.sprites);
+    out << ",\n  \"selfModifyingWrites\": [";
+    for (size_t k = 0; k < analysis.selfModifyingWrites.size(); k++) {
+        const MemoryWrite &w = analysis.selfModifyingWrites[k];
+        out << (k ? ", " : "") << "{\"pc\": " << w.pc << ", \"target\": " << w.target << ", \"length\": " << w.length << "}";
+    }
+    out << "],\n  \"unknownWrites\": [";
+    for (size_t k = 0; k < analysis.unknownWrites.size(); k++) {
+        out << (k ? ", " : "") << analysis.unknownWrites[k];
+    }
+    out << "],\n  \"deadCode\": ";
+    regions(analysis.deadCode);
+    out << ",\n  \"unknownData\": ";
+    regions(analysis.unknownData);
+    out << "\n}\n";
+    return out.str();
+}
+
+std::string analysisToDOT(const Analysis &analysis) {
+    std::unique_ptr<Chip8> machine = createMachine(analysis.mode);
+    std::stringstream out;
+    out << "digraph rom {\n";
+    out << "  node [shape=box, fontname=\"monospace\"];\n";
+    for (const auto &[start, block] : analysis.blocks) {
+        std::string label;
+        for (const auto &[address, text] : blockListing(analysis, block, *machine)) {
+            label += hex(address) + ": " + escape(text) + "\\l";
+        }
+        out << "  b" << start << " [label=\"" << label << "\"";
+        if (analysis.subroutines.count(start)) {
+            out << ", peripheries=2";
+        }
+        if (block.selfModified) {
+            out << ", color=red";
+        }
+        out << "];\n";
+        for (uint16_t successor : block.successors) {
+            if (analysis.blocks.count(successor)) {
+                out << "  b" << start << " -> b" << successor << ";\n";
+            }
+        }
+    }
+    out << "}\n";
+    return out.str();
+}
@@ -0,0 +1,64 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "Chip8.h"
+
+struct BasicBlock {
+    uint16_t start; // Address of the first instruction
+    uint32_t end; // Address past the last instruction, at most the memory size
+    std::vector<uint16_t> successors; // Statically known successor blocks
+    bool indirect = false; // Ends in a BNNN jump whose target is not known statically
+    bool selfModified = false; // A store in the ROM writes into this block
+    bool precompilable = false; // Safe to translate ahead of time: not self-modified and no store with unknown I
+};
+
+struct MemoryRegion {
+    uint16_t start;
+    uint16_t length;
+};
+
+struct MemoryWrite {
+    uint16_t pc; // Address of the storing instruction
+    uint16_t target; // First byte written
+    uint16_t length; // Bytes written
+};
+
+/*
+ * Result of a recursive-descent pass over a ROM image.
+ * Code is discovered by following every statically known control transfer from 0x200;
+ * the index register is tracked through ANNN/F000/FX29/FX30 so sprite data and stores
+ * can be located. Anything inside the ROM that is neither code nor data is reported as
+ * dead code (valid instructions) or unknown bytes.
+ */
+struct Analysis {
+    Mode mode;
+    std::vector<uint8_t> memory; // 64 KB image the addresses refer to
+    uint16_t romStart = 0x200;
+    uint16_t romEnd = 0x200; // Address past the last ROM byte
+    std::map<uint16_t, BasicBlock> blocks; // Keyed by start address
+    std::set<uint16_t> subroutines; // 2NNN targets
+    std::vector<MemoryRegion> sprites; // Bytes read by DXYN with a known I
+    std::vector<MemoryWrite> selfModifyingWrites; // Stores into code
+    std::vector<uint16_t> unknownWrites; // Stores whose target I is not known statically
+    std::vector<MemoryRegion> deadCode; // Unreached valid instructions
+    std::vector<MemoryRegion> unknownData; // Unreached bytes that are not valid code
+
+    bool isCode(uint16_t address) const; // Whether an instruction starts or continues at address
+    bool isPrecompilable(uint16_t address) const; // Whether the block containing address is safe to precompile
+};
+
+Analysis analyzeROM(const uint8_t *data, size_t size, Mode mode); // Analyze a ROM image loaded at 0x200
+std::string analysisToJSON(const Analysis &analysis); // Blocks with disassembly, data regions and writes
+std::string analysisToDOT(const Analysis &analysis); // Control-flow graph for Graphviz
+
+#endif //ANALYZER_H
@@ -1,69 +1,241 @@
 #include "Chip8.h"
+#include "RomLoader.h"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
+#include <typeinfo>
 #include <iomanip>
 
-Chip8::Chip8(): display(64, 32) {
-    pc = 0x200; // Program Counter starts at 0x200
-    index = 0; // Index Register
-    delay_timer = 0; // Delay Timer
-    sound_timer = 0; // Sound Timer
+namespace {
 
-    // Initialize memory
-    for (int i = 0; i < 4096; i++) {
-        memory[i] = 0;
+constexpr uint8_t FONT[80] = {
+    // Fontset data (5x5 pixels for each character)
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80 // F
+};
+
+constexpr uint8_t BIG_FONT[160] = {
+    // Big fontset data (8x10 pixels for each character)
+    0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+    0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+    0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+    0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+    0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+    0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+    0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0 // F
+};
+
+}
+
+// Both fonts at their addresses and the memory hash of the result, so a new machine needs no per-byte work
+struct Chip8::BootImage {
+    uint8_t bytes[BIG_FONT_ADDRESS + sizeof(BIG_FONT)]{};
+    uint64_t hash = 0;
+
+    constexpr BootImage() {
+        for (size_t i = 0; i < sizeof(FONT); i++) {
+            bytes[FONT_ADDRESS + i] = FONT[i];
+        }
+        for (size_t i = 0; i < sizeof(BIG_FONT); i++) {
+            bytes[BIG_FONT_ADDRESS + i] = BIG_FONT[i];
+        }
+        for (size_t address = 0; address < sizeof(bytes); address++) {
+            hash += elementHash(address, bytes[address]);
+        }
     }
+};
 
-    // Initialize registers
-    for (int i = 0; i < 16; i++) {
-        V[i] = 0;
+constexpr Chip8::BootImage Chip8::BOOT_IMAGE{};
+
+Chip8::Chip8(uint8_t *memory, uint32_t capacity): memory(memory, capacity), display(64, 32) {
+    // Registers, stack and keypad start from their member initializers; memory from one copy
+    std::memcpy(this->memory.bytes, BOOT_IMAGE.bytes, sizeof(BOOT_IMAGE.bytes));
+    this->memory.used = sizeof(BOOT_IMAGE.bytes);
+    memoryHash = BOOT_IMAGE.hash;
+}
+
+uint64_t Chip8::stateHash() const {
+    // Memory and display hashes are maintained on every write; the registers are hashed here
+    uint64_t hash = combineHash(memoryHash, display.getHash());
+    for (uint8_t value : V) {
+        hash = combineHash(hash, value);
     }
-    // Initialize stack
-    for (int i = 0; i < 16; i++) {
-        stack.data[i] = 0;
+    hash = combineHash(hash, static_cast<uint64_t>(pc) << 32 | static_cast<uint64_t>(index) << 16 | stack.sp);
+    for (int level = 0; level < stack.sp && level < 16; level++) {
+        hash = combineHash(hash, stack.data[level]);
     }
+    hash = combineHash(hash, static_cast<uint64_t>(getDelayTimer()) << 40 | static_cast<uint64_t>(getSoundTimer()) << 32 | rngState);
+    hash = combineHash(hash, (cycles - tickStart(getTicks())) << 32 | cyclesPerSecond); // Where in the tick, and its length
+    hash = combineHash(hash, static_cast<uint64_t>(mode) << 24 | planeMask << 16 | static_cast<uint8_t>(waitingKey) << 8 | halted);
+    return combineHash(hash, extraStateHash());
+}
 
-    // Initialize keypad
-    for (int i = 0; i < 16; i++) {
-        keypad[i] = false;
+bool Chip8::sameState(const Chip8 &other) const {
+    if (typeid(other) != typeid(*this) || pc != other.pc || index != other.index || stack.sp != other.stack.sp ||
+        rngState != other.rngState || mode != other.mode || planeMask != other.planeMask ||
+        waitingKey != other.waitingKey || halted != other.halted ||
+        getDelayTimer() != other.getDelayTimer() || getSoundTimer() != other.getSoundTimer() ||
+        cyclesPerSecond != other.cyclesPerSecond ||
+        cycles - tickStart(getTicks()) != other.cycles - other.tickStart(other.getTicks())) {
+        return false;
     }
-    // Load fontset into memory
-    uint8_t fontset[80] = {
-        // Fontset data (5x5 pixels for each character)
-        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-        0x20, 0x60, 0x20, 0x20, 0x70, // 1
-        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-        0xF0, 0x80, 0xF0, 0x80, 0x80 // F
-    };
-    for (int i = 0; i < 80; i++) {
-        memory[0x050 + i] = fontset[i];
+    if (!std::equal(std::begin(V), std::end(V), std::begin(other.V)) ||
+        !std::equal(stack.data, stack.data + std::min<int>(stack.sp, 16), other.stack.data)) {
+        return false;
+    }
+    if (display.getWidth() != other.display.getWidth() || display.getHeight() != other.display.getHeight() ||
+        std::memcmp(display.planes, other.display.planes, sizeof(display.planes)) != 0) {
+        return false;
+    }
+    // Subclass state is a few registers, its hash identifies it
+    return std::memcmp(memory.bytes, other.memory.bytes, memorySize()) == 0 && extraStateHash() == other.extraStateHash();
+}
+
+namespace {
+// Raw bytes of a register-sized value
+template <typename T>
+void appendBytes(std::string &key, const T &value) {
+    key.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// The 8-byte words of data that differ from base as (offset, word) pairs, ended by ~0; size is a multiple of 8
+void appendDiff(std::string &key, const void *data, const void *base, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    const uint8_t *baseBytes = static_cast<const uint8_t *>(base);
+    for (uint32_t block = 0; block < size; block += CACHE_LINE_SIZE) {
+        uint32_t end = static_cast<uint32_t>(std::min<size_t>(block + CACHE_LINE_SIZE, size));
+        if (std::memcmp(bytes + block, baseBytes + block, end - block) == 0) {
+            continue; // Most of memory and the screen match the base
+        }
+        for (uint32_t offset = block; offset < end; offset += sizeof(uint64_t)) {
+            uint64_t word, baseWord;
+            std::memcpy(&word, bytes + offset, sizeof(word));
+            std::memcpy(&baseWord, baseBytes + offset, sizeof(baseWord));
+            if (word != baseWord) {
+                appendBytes(key, offset);
+                appendBytes(key, word);
+            }
+        }
+    }
+    appendBytes(key, ~uint32_t{0});
+}
+}
+
+std::string Chip8::stateKey(const Chip8 &base) const {
+    if (typeid(base) != typeid(*this)) {
+        throw std::runtime_error("State keys need a base of the same core");
     }
+    // Every field is fixed-size or ended, so equal keys mean sameState()
+    std::string key;
+    appendBytes(key, pc);
+    appendBytes(key, index);
+    appendBytes(key, stack.sp);
+    appendBytes(key, rngState);
+    appendBytes(key, mode);
+    appendBytes(key, planeMask);
+    appendBytes(key, waitingKey);
+    appendBytes(key, halted);
+    appendBytes(key, getDelayTimer());
+    appendBytes(key, getSoundTimer());
+    appendBytes(key, cyclesPerSecond);
+    appendBytes(key, cycles - tickStart(getTicks()));
+    appendBytes(key, V);
+    key.append(reinterpret_cast<const char *>(stack.data), std::min<int>(stack.sp, 16) * sizeof(stack.data[0]));
+    appendBytes(key, display.getWidth());
+    appendBytes(key, display.getHeight());
+    appendDiff(key, display.planes, base.display.planes, sizeof(display.planes));
+    // Both are zero above the highest address either ever wrote
+    uint32_t written = std::min((std::max(memory.used, base.memory.used) + 7) & ~7u, memorySize());
+    appendDiff(key, memory.bytes, base.memory.bytes, written);
+    appendBytes(key, extraStateHash()); // As in sameState()
+    return key;
 }
 
 void Chip8::clearDisplay() {
-    std::fill(display.display.begin(), display.display.end(), false);
+    display.clear(planeMask);
+}
+
+uint8_t Chip8::randomByte() {
+    // xorshift32: cheap, identical on every platform, and the state is part of the machine
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return static_cast<uint8_t>(rngState >> 24);
+}
+
+void Chip8::skipNext() {
+    // F000 NNNN is the only 4-byte instruction
+    if (mode == Mode::XOCHIP && memory[pc] == 0xF0 && memory[(pc + 1) & memoryMask] == 0x00) {
+        pc = (pc + 4) & memoryMask;
+    } else {
+        pc = (pc + 2) & memoryMask;
+    }
+}
+
+void Chip8::drawSprite(uint8_t vx, uint8_t vy, int width, int height) {
+    int x = vx % display.getWidth();
+    int y = vy % display.getHeight();
+    int bytesPerRow = width / 8;
+    bool collision = false;
+
+    // Sprite data for each selected plane follows the previous plane's data
+    uint16_t address = index;
+    for (int plane = 0; plane < Display::PLANES; plane++) {
+        if (!(planeMask & (1 << plane))) {
+            continue;
+        }
+        for (int row = 0; row < height; ++row) {
+            int line = y + row;
+            if (line >= display.getHeight()) {
+                if (!quirks.wrapSprites) {
+                    break; // Clip at the bottom edge
+                }
+                line -= display.getHeight();
+            }
+            uint16_t at = (address + row * bytesPerRow) & memoryMask;
+            uint16_t bits = bytesPerRow == 2 ? (memory[at] << 8) | memory[(at + 1) & memoryMask] : memory[at];
+            collision |= display.drawRow(plane, x, line, bits, width, quirks.wrapSprites);
+        }
+        address += bytesPerRow * height;
+    }
+    V[0xF] = collision ? 1 : 0;
 }
 
 uint16_t Chip8::fetch() {
     // Fetch instruction from memory
-    uint16_t instruction = (memory[pc] << 8) | memory[pc + 1];
-    pc += 2; // Move to the next instruction
+    // Addresses wrap at the end of memory, so no ROM can reach outside the array
+    uint16_t instruction = (memory[pc & memoryMask] << 8) | memory[(pc + 1) & memoryMask];
+    pc = (pc + 2) & memoryMask; // Move to the next instruction
     return instruction;
 }
 
-Instruction Chip8::decode(uint16_t instruction) {
+Instruction Chip8::decode(uint16_t instruction) const {
     // Decode instruction
     uint8_t opcode = (instruction & 0xF000) >> 12;
     uint8_t x = (instruction & 0x0F00) >> 8;
@@ -74,445 +246,524 @@ Instruction Chip8::decode(uint16_t instruction) {
     return {opcode, x, y, n, nn, nnn};
 }
 
+Op Chip8::decodeOp(Instruction i) const {
+    Op op = DECODE_TABLE[i.raw()];
+    if (opInfo(op).platforms & platformBit(mode)) {
+        return op;
+    }
+    // Instructions from other platforms: DXY0 draws nothing, 0NNN is a machine code call,
+    // anything else is unknown
+    if (op == Op::DrawBig) {
+        return Op::Draw;
+    }
+    return i.opcode == 0x00 ? Op::Sys : Op::Invalid;
+}
+
 void Chip8::execute(Instruction i) {
     // Execute instruction
-    switch (i.opcode) {
-        case 0x00:
+    switch (decodeOp(i)) {
+        case Op::Cls:
             // Clear the display
-            switch (i.nnn) {
-                case 0x0E0:
-                    clearDisplay();
-                    break;
-                case 0x0EE:
-                    // Return from subroutine
-                    pc = stack.pop();
-                    break;
-                default:
-                    if (i.nnn == 0) {
-                        break;
-                    }
-                    // Call RCA 1802 program at address nnn
-                    //throw std::runtime_error("0NNN instruction: RCA 1802 program at address " + std::to_string(i.nnn));
-                    std::cout << "0NNN instruction: RCA 1802 program: 0x" << std::hex << (i.opcode << 12 | i.nnn) << std::endl;
-                    break;
+            clearDisplay();
+            break;
+        case Op::Ret:
+            // Return from subroutine
+            pc = stack.pop();
+            break;
+        case Op::Sys:
+            if (i.nnn == 0) {
+                break;
             }
+            // Call RCA 1802 program at address nnn
+            //throw std::runtime_error("0NNN instruction: RCA 1802 program at address " + std::to_string(i.nnn));
+            std::cout << "0NNN instruction: RCA 1802 program: 0x" << std::hex << i.raw() << std::endl;
             break;
-        case 0x01:
+        case Op::Jump:
             // Jump to address nnn
             pc = i.nnn;
             break;
-        case 0x02:
+        case Op::Call:
             // Call subroutine at nnn
             stack.push(pc);
             pc = i.nnn;
             break;
-        case 0x03:
+        case Op::SkipEqImm:
             // Skip next instruction if Vx == nn
             if (V[i.x] == i.nn) {
-                pc += 2;
+                skipNext();
             }
             break;
-        case 0x04:
+        case Op::SkipNeImm:
             // Skip next instruction if Vx != nn
             if (V[i.x] != i.nn) {
-                pc += 2;
+                skipNext();
             }
             break;
-        case 0x05:
+        case Op::SkipEqReg:
             // Skip next instruction if Vx == Vy
             if (V[i.x] == V[i.y]) {
-                pc += 2;
+                skipNext();
             }
             break;
-        case 0x09:
+        case Op::SkipNeReg:
             // Skip next instruction if Vx != Vy
             if (V[i.x] != V[i.y]) {
-                pc += 2;
+                skipNext();
             }
             break;
-        case 0x06:
+        case Op::LoadImm:
             // Set Vx to nn
             V[i.x] = i.nn;
             break;
-        case 0x07:
+        case Op::AddImm:
             // Add nn to Vx
             V[i.x] += i.nn;
             break;
-        case 0x0A:
+        case Op::LoadI:
             // Set I to nnn
             index = i.nnn;
             break;
-
-        case 0x08: // Math operations
-            switch (i.n) {
-                case 0x00:
-                    // Set Vx to Vy
-                    V[i.x] = V[i.y];
-                    break;
-                case 0x01:
-                    // Set Vx to Vx OR Vy
-                    V[i.x] |= V[i.y];
-                    if (!super_chip) {
-                        V[0xF] = 0; // Clear carry flag
-                    }
-                    break;
-                case 0x02:
-                    // Set Vx to Vx AND Vy
-                    V[i.x] &= V[i.y];
-                    if (!super_chip) {
-                        V[0xF] = 0; // Clear carry flag
-                    }
-                    break;
-                case 0x03:
-                    // Set Vx to Vx XOR Vy
-                    V[i.x] ^= V[i.y];
-                    if (!super_chip) {
-                        V[0xF] = 0; // Clear carry flag
-                    }
-                    break;
-                case 0x04: {
-                    // Add Vy to Vx, set VF to 1 if there is a carry
-                    const uint8_t x = V[i.x];
-                    V[i.x] += V[i.y];
-                    V[0xF] = (x + V[i.y]) > 0xFF ? 1 : 0;
-                    break;
-                }
-                case 0x05: {
-                    // Subtract Vy from Vx, set VF to 0 if there is a borrow
-                    const uint8_t x = V[i.x];
-                    V[i.x] = V[i.x] - V[i.y];
-                    V[0xF] = (x >= V[i.y]) ? 1 : 0;
-                    break;
-                }
-                case 0x07: {
-                    // Set Vx to Vy - Vx, set VF to 0 if there is a borrow
-                    const uint8_t x = V[i.x];
-                    V[i.x] = V[i.y] - V[i.x];
-                    V[0xF] = (V[i.y] >= x) ? 1 : 0;
-                    break;
-                }
-                case 0x06: {
-                    if (!super_chip) {
-                        // Move Vx to Vy
-                        V[i.x] = V[i.y];
-                    }
-                    // Shift Vx right by 1, set VF to the least significant bit of Vx before the shift
-                    const uint8_t x = V[i.x];
-                    V[i.x] >>= 1;
-                    V[0xF] = x & 0x01;
-                    break;
-                }
-                case 0x0E: {
-                    if (!super_chip) {
-                        // Move Vx to Vy
-                        V[i.x] = V[i.y];
-                    }
-                    // Shift Vx left by 1, set VF to the most significant bit of Vx before the shift
-                    const uint8_t x = V[i.x];
-                    V[i.x] <<= 1;
-                    V[0xF] = (x & 0x80) >> 7;
-                    break;
-                }
+        case Op::Move:
+            // Set Vx to Vy
+            V[i.x] = V[i.y];
+            break;
+        case Op::Or:
+            // Set Vx to Vx OR Vy
+            V[i.x] |= V[i.y];
+            if (quirks.vfReset) {
+                V[0xF] = 0; // Clear carry flag
+            }
+            break;
+        case Op::And:
+            // Set Vx to Vx AND Vy
+            V[i.x] &= V[i.y];
+            if (quirks.vfReset) {
+                V[0xF] = 0; // Clear carry flag
+            }
+            break;
+        case Op::Xor:
+            // Set Vx to Vx XOR Vy
+            V[i.x] ^= V[i.y];
+            if (quirks.vfReset) {
+                V[0xF] = 0; // Clear carry flag
             }
             break;
-        case 0x0B:
-            if (super_chip) {
+        case Op::Add: {
+            // Add Vy to Vx, set VF to 1 if there is a carry
+            const uint8_t x = V[i.x];
+            V[i.x] += V[i.y];
+            V[0xF] = (x + V[i.y]) > 0xFF ? 1 : 0;
+            break;
+        }
+        case Op::Sub: {
+            // Subtract Vy from Vx, set VF to 0 if there is a borrow
+            const uint8_t x = V[i.x];
+            V[i.x] = V[i.x] - V[i.y];
+            V[0xF] = (x >= V[i.y]) ? 1 : 0;
+            break;
+        }
+        case Op::SubN: {
+            // Set Vx to Vy - Vx, set VF to 0 if there is a borrow
+            const uint8_t x = V[i.x];
+            V[i.x] = V[i.y] - V[i.x];
+            V[0xF] = (V[i.y] >= x) ? 1 : 0;
+            break;
+        }
+        case Op::Shr: {
+            if (!quirks.shiftVxOnly) {
+                // Move Vx to Vy
+                V[i.x] = V[i.y];
+            }
+            // Shift Vx right by 1, set VF to the least significant bit of Vx before the shift
+            const uint8_t x = V[i.x];
+            V[i.x] >>= 1;
+            V[0xF] = x & 0x01;
+            break;
+        }
+        case Op::Shl: {
+            if (!quirks.shiftVxOnly) {
+                // Move Vx to Vy
+                V[i.x] = V[i.y];
+            }
+            // Shift Vx left by 1, set VF to the most significant bit of Vx before the shift
+            const uint8_t x = V[i.x];
+            V[i.x] <<= 1;
+            V[0xF] = (x & 0x80) >> 7;
+            break;
+        }
+        case Op::JumpOffset:
+            if (quirks.jumpVx) {
                 // Jump to address xnn + VX
-                pc = i.nnn + V[i.x];
+                pc = (i.nnn + V[i.x]) & memoryMask;
             } else {
                 // Jump to address nnn + V0
-                pc = i.nnn + V[0];
+                pc = (i.nnn + V[0]) & memoryMask;
             }
             break;
-        case 0x0C:
+        case Op::Random:
             // Generate random number and AND with nn, save in Vx
-            V[i.x] = rand() % 256 && i.nn;
-            break;
-        case 0x0D: {
-            uint8_t x = V[i.x] % display.getWidth();
-            uint8_t y = V[i.y] % display.getHeight();
-            V[0xF] = 0;
-
-            for (int row = 0; row < i.n; ++row) {
-                uint8_t sprite = memory[index + row];
-                for (int col = 0; col < 8; ++col) {
-                    // Cast sprite to bool, using bitmasking
-                    bool pixel = (sprite & (0x80 >> col)) != 0;
-                    if (pixel) {
-                        if (display.display[display.getWidth() * (y + row) + x + col]) {
-                            V[0xF] = 1; // Collision detected
-                            display.display[display.getWidth() * (y + row) + x + col] = false; // Erase pixel
-                        } else {
-                            display.display[display.getWidth() * (y + row) + x + col] = true;
-                        }
-                    }
-                    if (x + col >= display.getWidth()) {
-                        break; // Prevent overflow
+            V[i.x] = randomByte() & i.nn;
+            break;
+        case Op::Draw:
+            // Draw 8xN sprite at (Vx, Vy), VF = collision
+            drawSprite(V[i.x], V[i.y], 8, i.n);
+            break;
+        case Op::SkipKey:
+            // Skip next instruction if key with value of Vx is pressed
+            if (keypad[V[i.x] & 0xF]) {
+                skipNext();
+            }
+            break;
+        case Op::SkipNotKey:
+            // Skip next instruction if key with value of Vx is not pressed
+            if (!keypad[V[i.x] & 0xF]) {
+                skipNext();
+            }
+            break;
+        case Op::GetDelay:
+            // Set Vx to the value of the delay timer
+            V[i.x] = getDelayTimer();
+            break;
+        case Op::SetDelay:
+            // Set the delay timer to Vx
+            setDelayTimer(V[i.x]);
+            break;
+        case Op::SetSound:
+            // Set the sound timer to Vx
+            setSoundTimer(V[i.x]);
+            break;
+        case Op::AddI:
+            // Add Vx to I
+            index += V[i.x];
+            break;
+        case Op::WaitKey: {
+            // Wait for a key press and release
+            // If we haven't detected a pressed key yet
+            if (waitingKey == -1) {
+                for (int j = 0; j < 16; j++) {
+                    if (keypad[j]) {
+                        waitingKey = j;
+                        break;
                     }
                 }
-                if (y + row >= display.getHeight()) {
-                    break; // Prevent overflow
-                }
+                // Keep waiting for a key press
+                pc = (pc - 2) & memoryMask;
+            }
+            // If we have a pressed key, wait for release
+            else if (!keypad[waitingKey]) {
+                V[i.x] = waitingKey;
+                waitingKey = -1; // Reset for next time
+            }
+            // Key still pressed, keep waiting
+            else {
+                pc = (pc - 2) & memoryMask;
             }
             break;
         }
-        case 0x0E:
-            switch (i.nn) {
-                case 0x9E:
-                    // Skip next instruction if key with value of Vx is pressed
-                    if (keypad[V[i.x]]) {
-                        pc += 2;
-                    }
-                    break;
-                case 0xA1:
-                    // Skip next instruction if key with value of Vx is not pressed
-                    if (!keypad[V[i.x]]) {
-                        pc += 2;
-                    }
-                    break;
+        case Op::Font:
+            // Set I to the location of the sprite for the character in Vx
+            index = FONT_ADDRESS + (V[i.x] & 0xF) * 5; // Each character is 5 bytes
+            break;
+        case Op::Bcd:
+            // Store BCD representation of Vx in memory at I, I+1, I+2
+            storeByte(index & memoryMask, V[i.x] / 100);
+            storeByte((index + 1) & memoryMask, (V[i.x] / 10) % 10);
+            storeByte((index + 2) & memoryMask, V[i.x] % 10);
+            break;
+        case Op::Store:
+            // Store registers V0 to Vx in memory starting at I
+            for (int j = 0; j <= i.x; j++) {
+                storeByte((index + j) & memoryMask, V[j]);
             }
+            advanceIndex(i.x);
             break;
-        case 0x0F:
-            switch (i.nn) {
-                case 0x07:
-                    // Set Vx to the value of the delay timer
-                    V[i.x] = delay_timer;
-                    break;
-                case 0x15:
-                    // Set the delay timer to Vx
-                    delay_timer = V[i.x];
-                    break;
-                case 0x18:
-                    // Set the sound timer to Vx
-                    sound_timer = V[i.x];
-                    break;
-                case 0x1E:
-                    // Add Vx to I
-                    index += V[i.x];
-                    break;
-                case 0x0A: {
-                    // Wait for a key press and release
-                    static int lastPressed = -1;
-
-                    // If we haven't detected a pressed key yet
-                    if (lastPressed == -1) {
-                        for (int j = 0; j < 16; j++) {
-                            if (keypad[j]) {
-                                lastPressed = j;
-                                break;
-                            }
-                        }
-                        // Keep waiting for a key press
-                        pc -= 2;
-                    }
-                    // If we have a pressed key, wait for release
-                    else if (!keypad[lastPressed]) {
-                        V[i.x] = lastPressed;
-                        lastPressed = -1; // Reset for next time
-                    }
-                    // Key still pressed, keep waiting
-                    else {
-                        pc -= 2;
-                    }
-                    break;
-                }
-                case 0x29:
-                    // Set I to the location of the sprite for the character in Vx
-                    index = V[i.x] * 5; // Each character is 5 bytes
-                    break;
-                case 0x33:
-                    // Store BCD representation of Vx in memory at I, I+1, I+2
-                    memory[index] = V[i.x] / 100;
-                    memory[index + 1] = (V[i.x] / 10) % 10;
-                    memory[index + 2] = V[i.x] % 10;
-                    break;
-                case 0x55:
-                    if (super_chip) {
-                        // Store registers V0 to Vx in memory starting at I
-                        for (int j = 0; j <= i.x; j++) {
-                            memory[index + j] = V[j];
-                        }
-                    } else {
-                        // Store registers V0 to Vx in memory starting at I
-                        for (int j = 0; j <= i.x; j++) {
-                            memory[index] = V[j];
-                            index++;
-                        }
-                    }
-                    break;
-                case 0x65:
-                    if (super_chip) {
-                        // Read registers V0 to Vx from memory starting at I
-                        for (int j = 0; j <= i.x; j++) {
-                            V[j] = memory[index + j];
-                        }
-                    } else {
-                        // Read registers V0 to Vx from memory starting at I
-                        for (int j = 0; j <= i.x; j++) {
-                            V[j] = memory[index];
-                            index++;
-                        }
-                    }
-                    break;
+        case Op::Load:
+            // Read registers V0 to Vx from memory starting at I
+            for (int j = 0; j <= i.x; j++) {
+                V[j] = memory[(index + j) & memoryMask];
             }
+            advanceIndex(i.x);
             break;
         default:
             // Handle other opcodes here
-            std::cout << "Unknown instruction: 0x" << std::hex << (i.opcode << 12 | i.nnn) << std::endl;
+            std::cout << "Unknown instruction: 0x" << std::hex << i.raw() << std::endl;
             break;
     }
 }
 
-void Chip8::loadROM(const std::string &path) {
-    std::ifstream rom(path, std::ios::binary | std::ios::ate);
-    if (!rom.is_open()) {
-        throw std::runtime_error("Unable to open ROM file: " + path);
+void Chip8::advanceIndex(uint8_t x) {
+    // Apply the FX55/FX65 index quirk after a register dump/load
+    switch (quirks.memoryIncrement) {
+        case MemoryIncrement::None:
+            break;
+        case MemoryIncrement::ByX:
+            index += x;
+            break;
+        case MemoryIncrement::ByXPlus1:
+            index += x + 1;
+            break;
     }
+}
 
-    std::streamsize size = rom.tellg();
-    rom.seekg(0, std::ios::beg);
+MemoryAccess Chip8::memoryAccess(Instruction i) const {
+    int planes = std::max(1, std::popcount(planeMask));
+    switch (decodeOp(i)) {
+        case Op::Draw:
+            return {index, static_cast<uint16_t>(i.n * planes), false};
+        case Op::DrawBig:
+            return {index, static_cast<uint16_t>(32 * planes), false};
+        case Op::Bcd:
+            return {index, 3, true};
+        case Op::Store:
+            return {index, static_cast<uint16_t>(i.x + 1), true};
+        case Op::Load:
+            return {index, static_cast<uint16_t>(i.x + 1), false};
+        case Op::SaveRange:
+            return {index, static_cast<uint16_t>(std::abs(i.y - i.x) + 1), true};
+        case Op::LoadRange:
+            return {index, static_cast<uint16_t>(std::abs(i.y - i.x) + 1), false};
+        case Op::Audio:
+            return {index, 16, false};
+        default:
+            return {index, 0, false};
+    }
+}
 
-    if (size > 3584) {
+void Chip8::loadROM(const std::string &path) {
+    std::vector<uint8_t> rom = readROMFile(path);
+    loadROM(rom.data(), rom.size());
+}
+
+void Chip8::loadROM(const uint8_t *data, size_t size) {
+    if (size > memorySize() - 0x200) {
         throw std::runtime_error("ROM size exceeds memory capacity");
     }
 
-    rom.read(reinterpret_cast<char *>(&memory[0x200]), size);
-    rom.close();
+    for (size_t i = 0; i < size; i++) {
+        storeByte(static_cast<uint16_t>(0x200 + i), data[i]);
+    }
 }
 
 void Chip8::emulateCycle() {
+    if (halted) {
+        return; // 00FD stopped the machine
+    }
     // Fetch, decode, and execute instruction
     uint16_t instruction = fetch();
     Instruction decodedInstruction = decode(instruction);
     execute(decodedInstruction);
+    cycles++;
+}
+
+/*
+ * Superinstructions: a handful of idioms that dominate real ROMs run in a single dispatch.
+ * Each handler must leave the machine exactly as executing the sequence one instruction at
+ * a time would, and reports how many instructions that took so frame budgets stay exact.
+ * Idioms are matched against memory at the current pc on every dispatch, so self-modifying
+ * code needs no invalidation, and a jump into the middle of an idiom simply matches (or not)
+ * from its target: loop idioms are recognised at the loop head, never at the setup code
+ * before it. 0 means no idiom starts here (or the budget is too small) and nothing ran.
+ */
+int Chip8::executeFused(uint16_t instruction, int budget) {
+    const uint8_t opcode = instruction >> 12;
+    if (opcode != 0x6 && opcode != 0x7 && opcode != 0xA && opcode != 0xF) {
+        return 0; // Most instructions start no idiom; keep their dispatch cheap
+    }
+    const uint16_t head = (pc - 2) & memoryMask;
+    const uint8_t x = (instruction >> 8) & 0xF;
+    const uint16_t second = wordAt(head + 2);
+    uint16_t third = 0;
+    // 3X?? 1NNN after the head: "if vx != nn then jump nnn", ending a counter or wait loop
+    auto loopTail = [&] {
+        if ((second & 0xF000) != 0x3000 || ((second >> 8) & 0xF) != x) {
+            return false;
+        }
+        third = wordAt(head + 4);
+        return (third & 0xF000) == 0x1000;
+    };
+
+    switch (opcode) {
+        case 0x6:
+            // 6XNN FX15: set the delay timer to a constant
+            if (second == (0xF015 | x << 8) && budget >= 2) {
+                V[x] = instruction & 0xFF;
+                delayExpiry = tickAt(cycles + 1) + V[x]; // FX15 runs one cycle after the head
+                pc = (head + 4) & memoryMask;
+                return 2;
+            }
+            return 0;
+        case 0x7: {
+            // 7X01/7XFF 3XNN 1NNN: count up or down to nn
+            const uint8_t step = instruction & 0xFF;
+            if (budget < 3 || !loopTail()) {
+                return 0;
+            }
+            const uint8_t target = second & 0xFF;
+            if ((third & 0x0FFF) == head && (step == 0x01 || step == 0xFF)) {
+                // Loop back to the head: every pass but the last takes 3 instructions
+                int passes = static_cast<uint8_t>(step == 0x01 ? target - V[x] : V[x] - target);
+                int full = std::min((passes ? passes : 256) - 1, budget / 3);
+                if (full > 0) {
+                    V[x] += static_cast<uint8_t>(full * step);
+                    pc = head;
+                    return full * 3;
+                }
+            }
+            V[x] += step;
+            if (V[x] == target) {
+                pc = (head + 6) & memoryMask;
+                return 2;
+            }
+            pc = third & 0x0FFF;
+            return 3;
+        }
+        case 0xA:
+            // ANNN DXYN: point I at a sprite and draw it
+            if ((second & 0xF000) == 0xD000 && budget >= 2) {
+                index = instruction & 0x0FFF;
+                pc = (head + 4) & memoryMask;
+                execute(decode(second)); // Drawing differs between cores
+                return 2;
+            }
+            return 0;
+        case 0xF:
+            if ((instruction & 0xFF) == 0x07) {
+                // FX07 3X00 1NNN back to FX07: wait for the delay timer to reach 0
+                if (budget < 3 || (second & 0xFF) != 0 || !loopTail() || (third & 0x0FFF) != head) {
+                    return 0;
+                }
+                V[x] = getDelayTimer();
+                if (V[x] == 0) {
+                    pc = (head + 6) & memoryMask;
+                    return 2;
+                }
+                // Pass k reads the timer at cycles + 3k; spin through the passes that still read nonzero
+                const uint64_t passes = std::min<uint64_t>(budget / 3, (tickStart(delayExpiry) - cycles + 2) / 3);
+                V[x] = remaining(delayExpiry, tickAt(cycles + 3 * (passes - 1)));
+                pc = head;
+                return static_cast<int>(passes * 3);
+            }
+            if ((instruction & 0xFF) == 0x1E) {
+                // FX1E FY1E ...: pointer arithmetic
+                index += V[x];
+                int count = 1;
+                for (uint16_t next = second; count < budget && (next & 0xF0FF) == 0xF01E; next = wordAt(pc)) {
+                    index += V[(next >> 8) & 0xF];
+                    pc = (pc + 2) & memoryMask;
+                    count++;
+                }
+                return count;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+int Chip8::run(int instructions) {
+    int n = 0;
+    while (n < instructions && !halted) {
+        uint16_t instruction = fetch();
+        if (int fused = executeFused(instruction, instructions - n)) {
+            n += fused;
+            cycles += fused;
+            continue;
+        }
+        execute(decode(instruction));
+        cycles++; // Per instruction: timers read the clock
+        n++;
+    }
+    return n;
+}
+
+void Chip8::runFrame(int instructions) {
+    run(instructions);
+    updateTimers();
 }
 
 void Chip8::printDisplay() {
     for (int y = 0; y < display.getHeight(); y++) {
         for (int x = 0; x < display.getWidth(); x++) {
-            std::cout << (display.display[y * display.getWidth() + x] ? "█" : " ");
+            std::cout << (display.getPixel(x, y) ? "█" : " ");
         }
         std::cout << std::endl;
     }
 }
 
 void Chip8::setMode(Mode mode) {
-    super_chip = (mode == Mode::SUPERCHIP);
+    if (memorySizeFor(mode) > memory.capacity) {
+        throw std::runtime_error(std::string("This core cannot run ") + modeName(mode) + ", create it with createMachine()");
+    }
+    this->mode = mode;
+    quirks = quirksFor(mode);
+    memoryMask = static_cast<uint16_t>(memorySize() - 1);
 }
 
 void Chip8::updateTimers() {
-    // Update timers
-    if (delay_timer > 0) {
-        delay_timer--;
-    }
-    if (sound_timer > 0) {
-        sound_timer--;
-        if (sound_timer == 0) {
-            // Beep sound (not implemented)
-            std::cout << "Beep!" << std::endl;
-        }
+    // For frontends that tick once per frame: a frame that ran fewer instructions than a
+    // tick holds idles to the next tick, one that filled its tick is already there
+    uint64_t tick = getTicks();
+    if (cycles != tickStart(tick)) {
+        cycles = tickStart(tick + 1);
     }
 }
 
-std::string Chip8::disassemble(Instruction i) {
-    // convert decoded instruction to hex string
-    std::stringstream ss;
-    ss << std::hex << std::uppercase << std::setfill('0') << std::setw(4)
-       << ((i.opcode << 12) | (i.x << 8) | (i.y << 4) | i.n);
-    std::string instructionString = ss.str();
-    std::string result;
-
-    // disassemble instruction
-    if (instructionString == "00E0") {
-        result = "clear";
-    } else if (instructionString == "00EE") {
-        result = "return";
-    } else if (instructionString == "00FB") {
-        result = "scroll-right";
-    } else if (instructionString == "00FC") {
-        result = "scroll-left";
-    } else if (instructionString.substr(0, instructionString.size() - 1) == "00C") {
-        result = "scroll-down " + std::to_string(i.n);
+void Chip8::setClock(uint64_t cycles) {
+    uint8_t delay = getDelayTimer();
+    uint8_t sound = getSoundTimer();
+    this->cycles = cycles;
+    setDelayTimer(delay);
+    setSoundTimer(sound);
+}
+
+void Chip8::setCyclesPerSecond(uint32_t rate) {
+    if (rate == 0) {
+        throw std::runtime_error("The clock rate must be at least 1 instruction per second");
     }
-    else if (instructionString == "00FD") {
-        result = "exit";
-    } else if (instructionString == "00FE") {
-        result = "lores";
-    } else if (instructionString == "00FF") {
-        result = "hires";
+    if (rate == cyclesPerSecond) {
+        return;
     }
-    else if (instructionString[0] == '1') {
-        result = "jump 0x" + instructionString.substr(1);
-    } else if (instructionString[0] == '2') {
-        result = "call 0x" + instructionString.substr(1);
-    } else if (instructionString[0] == '3') {
-        result = "skip if V(0x" + std::string(1, instructionString[1]) + ") == 0x" + instructionString.substr(2);
-    } else if (instructionString[0] == '4') {
-        result = "skip if V(0x" + std::string(1, instructionString[1]) + ") != 0x" + instructionString.substr(2);
-    } else if (instructionString[0] == '5') {
-        result = "skip if V(0x" + std::string(1, instructionString[1]) + ") == V(0x" + instructionString[2] + ")";
-    } else if (instructionString[0] == '6') {
-        result = "V(0x" + std::string(1, instructionString[1]) + ") := 0x" + instructionString.substr(2);
-    } else if (instructionString[0] == '7') {
-        result = "V(0x" + std::string(1, instructionString[1]) + ") += 0x" + instructionString.substr(2);
-    } else if (instructionString[0] == '8') {
-        if (instructionString[3] == '0') {
-            result = "V(0x" + std::string(1, instructionString[1]) + ") := V(0x" + instructionString[2] + ")";
-        } else if (instructionString[3] == '1') {
-            result = "V(0x" + std::string(1, instructionString[1]) + ") := V(0x" + instructionString[1] + ") OR V(0x" + instructionString[2] + ")";
-        } else if (instructionString[3] == '2') {
-            result = "V(0x" + std::string(1, instructionString[1]) + ") := V(0x" + instructionString[1] + ") AND V(0x" + instructionString[2] + ")";
-        } else if (instructionString[3] == '3') {
-            result = "V(0x" + std::string(1, instructionString[1]) + ") := V(0x" + instructionString[1] + ") XOR V(0x" + instructionString[2] + ")";
-        } else if (instructionString[3] == '4') {
-            result = "V(0x" + std::string(1, instructionString[1]) + ") := V(0x" + instructionString[1] + ") + V(0x" + instructionString[2] + ")";
-        } else if (instructionString[3] == '5') {
-            result = "V(0x" + std::string(1, instructionString[1]) + ") := V(0x" + instructionString[1] + ") - V(0x" + instructionString[2] + ")";
-        } else if (instructionString[3] == '6') {
-            result = "V(0x" + std::string(1, instructionString[1]) + ") := V(0x" + instructionString[1] + ") >> 1";
-        } else if (instructionString[3] == '7') {
-            result = "V(0x" + std::string(1, instructionString[1]) + ") := V(0x" + instructionString[2] + ") - V(0x" + instructionString[1] + ")";
-        } else if (instructionString[3] == 'E') {
-            result = "V(0x" + std::string(1, instructionString[1]) + ") := V(0x" + instructionString[1] + ") << 1";
+    uint8_t delay = getDelayTimer();
+    uint8_t sound = getSoundTimer();
+    cyclesPerSecond = rate;
+    setDelayTimer(delay);
+    setSoundTimer(sound);
+}
+
+std::string Chip8::disassemble(Instruction i) const {
+    // Expand the mnemonic format of the decoded instruction
+    const char *format = opInfo(i.raw()).format;
+    std::stringstream ss;
+    ss << std::uppercase;
+
+    for (const char *c = format; *c; c++) {
+        if (*c != '{') {
+            ss << *c;
+            continue;
         }
-    } else if (instructionString[0] == '9') {
-        result = "skip if V(0x" + std::string(1, instructionString[1]) + ") != V(0x" + instructionString[2] + ")";
-    } else if (instructionString[0] == 'A') {
-        result = "I := 0x" + instructionString.substr(1);
-    } else if (instructionString[0] == 'B') {
-        result = "jump V0 + 0x" + instructionString.substr(1);
-    } else if (instructionString[0] == 'C') {
-        result = "rand, bitmask V(0x" + std::string(1, instructionString[1]) + ")";
-    } else if (instructionString[0] == 'D') {
-        result = "draw (" + std::to_string(i.x) + ", " + std::to_string(i.y) +
-                             "), height " + std::to_string(i.n);
-    } else if (instructionString[0] == 'E') {
-        if (instructionString.substr(2) == "9E") {
-            result = "skip if key V(0x" + std::string(1, instructionString[1]) + ") pressed";
-        } else if (instructionString.substr(2) == "A1") {
-            result = "skip if key V(0x" + std::string(1, instructionString[1]) + ") not pressed";
+        std::string field;
+        for (c++; *c && *c != '}'; c++) {
+            field += *c;
         }
-    } else if (instructionString[0] == 'F') {
-        if (instructionString.substr(2) == "07") {
-            result = "delay store V(0x" + std::string(1, instructionString[1]) + ")";
-        } else if (instructionString.substr(2) == "0A") {
-            result = "wait for key V(0x" + std::string(1, instructionString[1]) + ")";
-        } else if (instructionString.substr(2) == "15") {
-            result = "delay set V(0x" + std::string(1, instructionString[1]) + ")";
-        } else if (instructionString.substr(2) == "18") {
-            result = "sound set V(0x" + std::string(1, instructionString[1]) + ")";
-        } else if (instructionString.substr(2) == "1E") {
-            result = "I += V(0x" + std::string(1, instructionString[1]) + ")";
-        } else if (instructionString.substr(2) == "29") {
-            result = "I := addr sprite V(0x" + std::string(1, instructionString[1]) + ")";
-        } else if (instructionString.substr(2) == "33") {
-            result = "BCD store V(0x" + std::string(1, instructionString[1]) + ")";
-        } else if (instructionString.substr(2) == "55") {
-            result = "store V0 to V(0x" + std::string(1, instructionString[1]) + ")";
-        } else if (instructionString.substr(2) == "65") {
-            result = "load V0 to V(0x" + std::string(1, instructionString[1]) + ")";
+        if (field == "X") {
+            ss << std::hex << +i.x;
+        } else if (field == "Y") {
+            ss << std::hex << +i.y;
+        } else if (field == "NN") {
+            ss << std::hex << std::setfill('0') << std::setw(2) << i.nn;
+        } else if (field == "NNN") {
+            ss << std::hex << std::setfill('0') << std::setw(3) << i.nnn;
+        } else if (field == "x") {
+            ss << std::dec << +i.x;
+        } else if (field == "y") {
+            ss << std::dec << +i.y;
+        } else if (field == "n") {
+            ss << std::dec << +i.n;
+        }
+        if (!*c) {
+            break;
         }
     }
 
-    return result;
+    return ss.str();
 }
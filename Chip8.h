@@ -5,8 +5,19 @@
 #ifndef CHIP8_H
 #define CHIP8_H
 
+#include <algorithm>
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include "Display.h"
+#include "Opcodes.h"
 
 struct Instruction {
     uint8_t opcode; // The opcode of the instruction
@@ -15,11 +26,72 @@ struct Instruction {
     uint8_t n; // The third operand
     uint16_t nn; // The immediate value
     uint16_t nnn; // The address
+
+    uint16_t raw() const { return (opcode << 12) | nnn; } // The instruction word
 };
 
 enum class Mode {
-    CHIP8,
-    SUPERCHIP
+    CHIP8, // COSMAC VIP CHIP-8
+    SCHIP10, // SUPER-CHIP 1.0 (HP48)
+    SCHIP11, // SUPER-CHIP 1.1 (HP48)
+    SUPERCHIP, // Modern SUPER-CHIP (Octo)
+    XOCHIP // XO-CHIP
+};
+
+constexpr const char *modeName(Mode mode) {
+    switch (mode) {
+        case Mode::SCHIP10: return "schip10";
+        case Mode::SCHIP11: return "schip11";
+        case Mode::SUPERCHIP: return "superchip";
+        case Mode::XOCHIP: return "xochip";
+        case Mode::CHIP8:
+        default: return "chip8";
+    }
+}
+
+// Bit of a platform in OpInfo::platforms
+constexpr uint8_t platformBit(Mode mode) {
+    return static_cast<uint8_t>(1 << static_cast<int>(mode));
+}
+
+static_assert(platformBit(Mode::CHIP8) == P_CHIP8 && platformBit(Mode::XOCHIP) == P_XOCHIP);
+
+// How FX55/FX65 leave the index register after a register dump/load
+enum class MemoryIncrement : uint8_t {
+    None, // I is left unchanged
+    ByX, // I += X
+    ByXPlus1 // I += X + 1
+};
+
+struct Quirks {
+    bool vfReset; // 8XY1/8XY2/8XY3 reset VF to 0
+    bool shiftVxOnly; // 8XY6/8XYE shift Vx in place instead of copying Vy first
+    bool jumpVx; // BNNN behaves as BXNN (jump to XNN + Vx)
+    MemoryIncrement memoryIncrement; // FX55/FX65 index increment
+    bool wrapSprites; // Sprites wrap around screen edges instead of being clipped
+};
+
+// Quirk profile of each supported platform
+constexpr Quirks quirksFor(Mode mode) {
+    switch (mode) {
+        case Mode::SCHIP10:
+            return {false, true, true, MemoryIncrement::ByX, false};
+        case Mode::SCHIP11:
+        case Mode::SUPERCHIP:
+            return {false, true, true, MemoryIncrement::None, false};
+        case Mode::XOCHIP:
+            return {false, false, false, MemoryIncrement::ByXPlus1, true};
+        case Mode::CHIP8:
+        default:
+            return {true, false, false, MemoryIncrement::ByXPlus1, false};
+    }
+}
+
+// Memory touched through I by one instruction
+struct MemoryAccess {
+    uint16_t address; // First byte
+    uint16_t length; // Bytes touched, 0 if the instruction does not use memory
+    bool write; // Store rather than load
 };
 
 struct Chip8Stack {
@@ -42,24 +114,58 @@ struct Chip8Stack {
     }
 };
 
-class Display {
-    int width;
-    int height;
-public:
-    std::vector<bool> display;
-    Display(int width, int height) {
-        this->width = width;
-        this->height = height;
-        display = std::vector<bool>(width * height, false);
-    };
-    int getWidth() const { return width; }
-    int getHeight() const { return height; }
+// Machines are aligned to cache lines so hot state never shares a line with another instance
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Bytes of an address space, the last member of a Machine. Left uninitialized: the
+// core clears or copies them through MachineMemory while it is constructed.
+template <uint32_t Size>
+struct MemoryStorage {
+    alignas(CACHE_LINE_SIZE) uint8_t bytes[Size];
 };
 
-class Chip8 {
+/*
+ * Address space of a machine, in storage the concrete Machine owns and sizes for its core
+ * type: 4 KB for Chip8 and SuperChip, 64 KB for XOChip.
+ * A copy starts without storage; the Machine being constructed seats it in its own with
+ * seat(). It remembers how far it was ever written and assignment stops at the higher
+ * mark of both sides (everything above is zero on both), so restoring a snapshot moves
+ * the bytes the program used rather than the whole address space. Both sides of an
+ * assignment belong to the same core type, so their capacities match.
+ * Reads index it like an array; writes go through store() to keep the mark.
+ */
+struct MachineMemory {
+    uint8_t *bytes = nullptr; // capacity bytes owned by the Machine
+    uint32_t used = 0; // One past the highest address written
+    uint32_t capacity = 0;
+
+    MachineMemory(uint8_t *storage, uint32_t capacity) : bytes(storage), capacity(capacity) {
+        std::memset(bytes, 0, capacity);
+    }
+    MachineMemory(const MachineMemory &other) : used(other.used), capacity(other.capacity) {}
+    MachineMemory &operator=(const MachineMemory &other) {
+        std::memcpy(bytes, other.bytes, std::max(used, other.used));
+        used = other.used;
+        return *this;
+    }
+
+    void seat(uint8_t *storage, const MachineMemory &source) { // Take storage for a copy of source
+        bytes = storage;
+        std::memcpy(bytes, source.bytes, used);
+        std::memset(bytes + used, 0, capacity - used);
+    }
+
+    uint8_t operator[](uint32_t address) const { return bytes[address]; }
+    void store(uint16_t address, uint8_t value) {
+        bytes[address] = value;
+        used = std::max<uint32_t>(used, address + 1u);
+    }
+};
+
+class alignas(CACHE_LINE_SIZE) Chip8 {
     /*
-     * Memory: CHIP-8 has direct access to up to 4 kilobytes of RAM
-     * Display: 64 x 32 pixels (or 128 x 64 for SUPER-CHIP) monochrome, ie. black or white
+     * Memory: CHIP-8 has direct access to up to 4 kilobytes of RAM (64 kilobytes for XO-CHIP)
+     * Display: 64 x 32 pixels (or 128 x 64 for SUPER-CHIP) monochrome, ie. black or white (4 colors for XO-CHIP)
      * A program counter, often called just “PC”, which points at the current instruction in memory
      * One 16-bit index register called “I” which is used to point at locations in memory
      * A stack for 16-bit addresses, which is used to call subroutines/functions and return from them
@@ -67,32 +173,178 @@ class Chip8 {
      * An 8-bit sound timer which functions like the delay timer, but which also gives off a beeping sound as long as it’s not 0
      * 16 8-bit (one byte) general-purpose variable registers numbered 0 through F hexadecimal, ie. 0 through 15 in decimal, called V0 through VF
      * VF is also used as a flag register; many instructions will set it to either 1 or 0 based on some rule, for example using it as a carry flag
+     *
+     * Layout: members are declared in the order they are laid out. Everything a typical
+     * instruction touches shares the first cache line with the vtable pointer; the stack and
+     * keypad fill the second, the cycle counter, memory hash and memory header the third;
+     * the framebuffer starts on a line of its own. The memory bytes follow the core's own
+     * members in the Machine that wraps it, so the object has no heap-allocated parts and
+     * copying or resetting it never allocates. A CHIP-8 or SUPER-CHIP machine is about
+     * 6 KB, an XO-CHIP machine about 66 KB.
+     *
+     * Cores are abstract: Machine<Core> below adds the memory and is the type created.
+     * Copying is protected, so a machine is only copied whole, through clone(), cloneInto()
+     * or restore(), and never sliced into a core of another type.
+     *
+     * Timers: the 60 Hz tick is derived from the cycle counter and the configured clock
+     * rate, so the timers advance with the instructions executed and need no per-frame call.
+     * The delay and sound timers are stored as the tick at which they reach 0 and evaluated
+     * only when read.
      */
-    uint16_t pc; // Program Counter
-    Chip8Stack stack; // Stack with push/pop
-    uint8_t delay_timer; // Delay Timer
-    uint8_t sound_timer; // Sound Timer
+protected:
+    static constexpr uint16_t FONT_ADDRESS = 0x050; // 5-byte hex digits
+    static constexpr uint16_t BIG_FONT_ADDRESS = 0x0A0; // 10-byte hex digits (SUPER-CHIP/XO-CHIP)
+    static constexpr uint32_t DEFAULT_SEED = 0x2545F491;
+    static constexpr uint32_t TIMER_HZ = 60; // Delay and sound timer rate
+
+    // First cache line: hot registers
+    uint16_t pc = 0x200; // Program Counter
+    uint16_t index = 0; // Index Register
+    uint16_t memoryMask = 0xFFF; // memorySize() - 1, applied to every computed address
+    uint8_t planeMask = 0x1; // Bit planes affected by drawing, clearing and scrolling
+    bool halted = false; // Set by 00FD, emulateCycle() does nothing afterwards
+    uint8_t V[16]{}; // Registers
+private:
+    int8_t waitingKey = -1; // FX0A: key seen pressed, waiting for its release
+protected:
+    Quirks quirks = quirksFor(Mode::CHIP8); // Behaviour differences of the current platform
+    Mode mode = Mode::CHIP8; // Platform being emulated
+private:
+    uint32_t rngState = DEFAULT_SEED; // xorshift32 state for CXNN, never 0
+    uint64_t cycles = 0; // Emulated clock: instructions executed, plus the rest of ticks ended by updateTimers()
+    uint64_t delayExpiry = 0; // Tick at which the delay timer reads 0
+
+    // Second cache line: call stack and input
+    alignas(CACHE_LINE_SIZE) Chip8Stack stack; // Stack with push/pop
+public:
+    bool keypad[16]{}; // Keypad
+private:
+    uint64_t soundExpiry = 0; // Tick at which the sound timer reads 0
+
+    // Third cache line: clock rate, counters and where memory is
+    alignas(CACHE_LINE_SIZE) uint32_t cyclesPerSecond = DEFAULT_CYCLES_PER_SECOND; // Instructions per second of emulated time
+protected:
+    uint64_t memoryHash = 0; // Sum of elementHash over memory, kept current by storeByte()
+    MachineMemory memory; // Memory
+
+    // Framebuffer and memory bytes, each starting on its own line
+public:
+    alignas(CACHE_LINE_SIZE) Display display; // Display
+private:
+    struct BootImage; // Memory below 0x200 at power-on, built at compile time
+    static const BootImage BOOT_IMAGE;
 
     void clearDisplay(); // Clear display
+    uint8_t randomByte(); // Next byte from the machine's own generator
+    void advanceIndex(uint8_t x); // Apply FX55/FX65 index quirk
+    uint64_t tickAt(uint64_t cycle) const { return cycle * TIMER_HZ / cyclesPerSecond; } // 60 Hz tick a cycle falls in
+    uint64_t tickStart(uint64_t tick) const { return (tick * cyclesPerSecond + TIMER_HZ - 1) / TIMER_HZ; } // First cycle of a tick
+    static uint8_t remaining(uint64_t expiry, uint64_t tick) { return expiry > tick ? static_cast<uint8_t>(expiry - tick) : 0; }
+    uint16_t wordAt(uint16_t address) const { // Instruction word at address, wrapping like fetch()
+        return (memory[address & memoryMask] << 8) | memory[(address + 1) & memoryMask];
+    }
+    int executeFused(uint16_t instruction, int budget); // Run an idiom starting with the fetched instruction
 
 protected:
-    bool super_chip = false; // Super Chip mode
-    uint8_t V[16]{}; // Registers
-    uint8_t memory[4096]{}; // Memory
-    uint16_t index; // Index Register
+    void storeByte(uint16_t address, uint8_t value) { // Every memory write goes through here
+        memoryHash += elementHash(address, value) - elementHash(address, memory[address]);
+        memory.store(address, value);
+    }
+    virtual uint64_t extraStateHash() const { return 0; } // State added by subclasses
+    void skipNext(); // Skip the next instruction (XO-CHIP skips over 4-byte F000 NNNN too)
+    void drawSprite(uint8_t vx, uint8_t vy, int width, int height); // XOR sprite at I onto the selected planes
+    explicit Chip8(uint8_t *memory, uint32_t capacity = MEMORY_SIZE); // Power on with capacity bytes of storage at memory
+    Chip8(const Chip8 &) = default; // The Machine seats the copy's memory
+    Chip8 &operator=(const Chip8 &) = default;
 public:
-    Chip8(); // Constructor
+    static constexpr uint32_t MEMORY_SIZE = 0x1000; // Address space a core of this type is built with
+    static constexpr uint32_t DEFAULT_CYCLES_PER_SECOND = 8 * TIMER_HZ; // 8 instructions per timer tick
+
+    virtual ~Chip8() = default; // Cores are owned through std::unique_ptr<Chip8>
+    virtual std::unique_ptr<Chip8> clone() const = 0; // Snapshot of the complete machine state
+    virtual Chip8 *cloneInto(void *at) const = 0; // Copy constructed at objectSize() bytes aligned to CACHE_LINE_SIZE
+    virtual size_t objectSize() const = 0; // sizeof the concrete machine, a multiple of CACHE_LINE_SIZE
+    virtual void restore(const Chip8 &snapshot) = 0; // Return to a snapshot taken from the same core type
     uint16_t fetch(); // Fetch instruction
-    Instruction decode(uint16_t instruction); // Decode instruction
+    Instruction decode(uint16_t instruction) const; // Decode instruction
+    Op decodeOp(Instruction i) const; // Classify instruction for the current platform
     virtual void execute(Instruction i); // Execute instruction
     void loadROM(const std::string &path); // Load ROM file
+    void loadROM(const uint8_t *data, size_t size); // Load ROM image from memory
     void emulateCycle(); // Emulate a single cycle
+    int run(int instructions); // Emulate instructions cycles with fused idioms, returns the cycles run before halting
+    void runFrame(int instructions); // Emulate instructions cycles, then end the current 60 Hz tick
     void printDisplay(); // Print display (for debugging)
-    Display display; // Display
-    bool keypad[16]{}; // Keypad
-    void setMode(Mode mode);
-    std::string disassemble(Instruction i); // Return disassembled instruction string
-    void updateTimers(); // Update timers
+    void setKeys(uint16_t mask) { // Key n held while bit n is set
+        for (int key = 0; key < 16; key++) {
+            keypad[key] = mask & (1 << key);
+        }
+    }
+    uint32_t memorySize() const { return memorySizeFor(mode); } // Addressable bytes
+    static constexpr uint32_t memorySizeFor(Mode mode) { return mode == Mode::XOCHIP ? 0x10000 : 0x1000; }
+    void setMode(Mode mode); // Select platform and apply its quirk profile; throws if the core's memory is too small
+    uint64_t stateHash() const; // Everything that determines future execution except the keypad; O(registers)
+    bool sameState(const Chip8 &other) const; // What stateHash() covers, compared exactly; O(memory)
+    std::string stateKey(const Chip8 &base) const; // What sameState() compares, packed as a diff against base of the same core
+    uint64_t getMemoryHash() const { return memoryHash; }
+    void setSeed(uint32_t seed) { rngState = seed ? seed : DEFAULT_SEED; } // Same seed, same CXNN sequence
+    Mode getMode() const { return mode; }
+    bool isHalted() const { return halted; }
+    const Quirks &getQuirks() const { return quirks; }
+    std::string disassemble(Instruction i) const; // Return disassembled instruction string
+    MemoryAccess memoryAccess(Instruction i) const; // Memory the instruction would touch if executed now
+    void updateTimers(); // Compatibility: idle to the end of the current 60 Hz tick; the timers run without it
+    uint64_t getCycles() const { return cycles; }
+    uint64_t getTicks() const { return tickAt(cycles); } // 60 Hz ticks since power-on
+    void setClock(uint64_t cycles); // Move the clock, keeping the timer values
+    uint32_t getCyclesPerSecond() const { return cyclesPerSecond; }
+    void setCyclesPerSecond(uint32_t rate); // Emulated CPU speed, keeping the timer values; throws if 0
+    bool isSoundOn() const { return soundExpiry > getTicks(); } // Sound timer nonzero
+
+    // Register and memory access for debuggers
+    uint16_t getPC() const { return pc; }
+    void setPC(uint16_t value) { pc = value; }
+    uint16_t getIndex() const { return index; }
+    void setIndex(uint16_t value) { index = value; }
+    uint8_t getV(int reg) const { return V[reg & 0xF]; }
+    void setV(int reg, uint8_t value) { V[reg & 0xF] = value; }
+    uint8_t getSP() const { return stack.sp; }
+    uint16_t getStack(int level) const { return stack.data[level & 0xF]; }
+    uint8_t getDelayTimer() const { return remaining(delayExpiry, getTicks()); }
+    void setDelayTimer(uint8_t value) { delayExpiry = getTicks() + value; }
+    uint8_t getSoundTimer() const { return remaining(soundExpiry, getTicks()); }
+    void setSoundTimer(uint8_t value) { soundExpiry = getTicks() + value; }
+    // Addresses wrap at memorySize(), as they do for the program
+    uint8_t readMemory(uint16_t address) const { return memory[address & memoryMask]; }
+    const uint8_t *getMemory() const { return memory.bytes; } // memorySize() bytes
+    void writeMemory(uint16_t address, uint8_t value) { storeByte(address & memoryMask, value); }
+    uint16_t peek(uint16_t address) const { return wordAt(address); } // Instruction word at address, without fetching it
+};
+
+/*
+ * A core with the memory its type needs, the class that is actually instantiated:
+ * Machine<Chip8>, Machine<SuperChip> or Machine<XOChip>. The storage is the last
+ * member, so the hot state of every core stays at the start of the object.
+ */
+template <typename Core>
+class Machine final : public Core {
+    MemoryStorage<Core::MEMORY_SIZE> storage; // Cleared by the core's constructor
+
+    Machine(const Machine &other) : Core(other) { this->memory.seat(storage.bytes, other.memory); }
+    Machine &operator=(const Machine &other) = default; // MachineMemory copies the bytes in use
+
+public:
+    Machine() : Core(storage.bytes) {}
+
+    std::unique_ptr<Chip8> clone() const override { return std::unique_ptr<Chip8>(new Machine(*this)); }
+    Chip8 *cloneInto(void *at) const override { return new (at) Machine(*this); }
+    size_t objectSize() const override { return sizeof(Machine); }
+    void restore(const Chip8 &snapshot) override {
+        if (typeid(snapshot) != typeid(*this)) {
+            throw std::runtime_error("Snapshot was taken from a different core");
+        }
+        *this = static_cast<const Machine &>(snapshot);
+    }
 };
 
 #endif //CHIP8_H
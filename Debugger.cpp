@@ -0,0 +1,141 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "Debugger.h"
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+std::string hex(uint32_t value, int width = 3) {
+    std::stringstream ss;
+    ss << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(width) << value;
+    return ss.str();
+}
+
+}
+
+bool RegisterCondition::evaluate(const Chip8 &machine) const {
+    uint16_t current = reg == 16 ? machine.getIndex() : machine.getV(reg);
+    switch (compare) {
+        case Compare::Equal: return current == value;
+        case Compare::NotEqual: return current != value;
+        case Compare::Less: return current < value;
+        case Compare::Greater: return current > value;
+        case Compare::LessEqual: return current <= value;
+        case Compare::GreaterEqual: return current >= value;
+    }
+    return false;
+}
+
+RegisterCondition RegisterCondition::parse(const std::string &text) {
+    static const std::pair<const char *, Compare> OPERATORS[] = {
+        {"==", Compare::Equal}, {"!=", Compare::NotEqual}, {"<=", Compare::LessEqual},
+        {">=", Compare::GreaterEqual}, {"<", Compare::Less}, {">", Compare::Greater}
+    };
+
+    for (const auto &[symbol, compare] : OPERATORS) {
+        size_t at = text.find(symbol);
+        if (at == std::string::npos) {
+            continue;
+        }
+        std::string name = text.substr(0, at);
+        std::string value = text.substr(at + std::string(symbol).size());
+        int reg;
+        if (name == "I" || name == "i") {
+            reg = 16;
+        } else if (name.size() == 2 && (name[0] == 'V' || name[0] == 'v') && std::isxdigit(name[1])) {
+            reg = std::stoi(name.substr(1), nullptr, 16);
+        } else {
+            throw std::runtime_error("Invalid register in condition: " + text);
+        }
+        return {reg, compare, static_cast<uint16_t>(std::stoul(value, nullptr, 0))};
+    }
+    throw std::runtime_error("Invalid condition (expected e.g. V3==0x10): " + text);
+}
+
+void Debugger::removeWatchpoint(const Watchpoint &watchpoint) {
+    auto it = std::find(watchpoints.begin(), watchpoints.end(), watchpoint);
+    if (it != watchpoints.end()) {
+        watchpoints.erase(it);
+    }
+}
+
+void Debugger::clear() {
+    breakpoints.clear();
+    watchpoints.clear();
+    conditions.clear();
+    runTo.reset();
+}
+
+StopReason Debugger::stop(StopReason reason, const std::string &message) {
+    stopMessage = message;
+    return reason;
+}
+
+StopReason Debugger::run(Chip8 &machine, uint32_t cycles) {
+    for (uint32_t n = 0; n < cycles; n++) {
+        uint16_t pc = machine.getPC();
+        bool resuming = resumeAddress == pc;
+        resumeAddress.reset();
+
+        if (runTo && pc == runTo->first && machine.getSP() == runTo->second) {
+            runTo.reset();
+            resumeAddress = pc;
+            return stop(StopReason::Step, "Stepped over call, PC " + hex(pc));
+        }
+        if (!resuming && breakpoints.count(pc)) {
+            resumeAddress = pc;
+            return stop(StopReason::Breakpoint, "Breakpoint at " + hex(pc));
+        }
+
+        // Check watched memory before the instruction touches it
+        Instruction i = machine.decode(machine.peek(pc));
+        MemoryAccess access = machine.memoryAccess(i);
+        if (!resuming && access.length > 0) {
+            for (const Watchpoint &w : watchpoints) {
+                bool overlaps = access.address < w.address + w.length && w.address < access.address + access.length;
+                if (overlaps && (access.write ? w.write : w.read)) {
+                    resumeAddress = pc;
+                    return stop(StopReason::Watchpoint,
+                                std::string(access.write ? "Write" : "Read") + " of " + hex(access.address, 4) +
+                                " (" + std::to_string(access.length) + " bytes) at " + hex(pc) + ": " +
+                                machine.disassemble(i));
+                }
+            }
+        }
+
+        machine.emulateCycle();
+
+        for (RegisterCondition &condition : conditions) {
+            bool isTrue = condition.evaluate(machine);
+            bool triggered = isTrue && !condition.wasTrue;
+            condition.wasTrue = isTrue;
+            if (triggered) {
+                return stop(StopReason::Condition, "Condition met after " + hex(pc) + ": " + machine.disassemble(i));
+            }
+        }
+    }
+    return StopReason::None;
+}
+
+StopReason Debugger::step(Chip8 &machine) {
+    resumeAddress = machine.getPC(); // Stepping never stops on the current instruction
+    StopReason reason = run(machine, 1);
+    return reason == StopReason::None ? stop(StopReason::Step, "Step to " + hex(machine.getPC())) : reason;
+}
+
+StopReason Debugger::stepOver(Chip8 &machine) {
+    Instruction i = machine.decode(machine.peek(machine.getPC()));
+    if (machine.decodeOp(i) != Op::Call) {
+        return step(machine);
+    }
+    // Run until the call returns to the next instruction at the current stack depth
+    runTo = std::make_pair(static_cast<uint16_t>(machine.getPC() + 2), machine.getSP());
+    resumeAddress = machine.getPC();
+    return run(machine, 1);
+}
@@ -0,0 +1,79 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+#include "Chip8.h"
+
+enum class StopReason {
+    None, // Ran the requested number of cycles
+    Breakpoint, // PC reached a breakpoint
+    Watchpoint, // An instruction is about to touch a watched memory range
+    Condition, // A register condition became true
+    Step // Single step or step-over finished
+};
+
+struct Watchpoint {
+    uint16_t address;
+    uint16_t length;
+    bool read; // Break on loads (DXYN, FX65, ...)
+    bool write; // Break on stores (FX33, FX55, ...)
+
+    bool operator==(const Watchpoint &) const = default;
+};
+
+// Register condition, e.g. "V3 == 0x10"; breaks when it changes from false to true
+struct RegisterCondition {
+    enum class Compare { Equal, NotEqual, Less, Greater, LessEqual, GreaterEqual };
+    int reg; // 0-15 for V0-VF, 16 for I
+    Compare compare;
+    uint16_t value;
+    bool wasTrue = false;
+
+    bool evaluate(const Chip8 &machine) const;
+    static RegisterCondition parse(const std::string &text); // "V3==0x10", "I>=0x300", ...
+};
+
+/*
+ * Breakpoints, watchpoints and stepping.
+ * The debugger owns a separate dispatch loop that checks every instruction before it
+ * executes; frontends only route cycles through run() while isActive() is true, so
+ * emulateCycle() never pays for any of the checks.
+ */
+class Debugger {
+    std::set<uint16_t> breakpoints;
+    std::vector<Watchpoint> watchpoints;
+    std::vector<RegisterCondition> conditions;
+
+    std::optional<uint16_t> resumeAddress; // Stopped here, don't re-trigger on resume
+    std::optional<std::pair<uint16_t, uint8_t>> runTo; // Step-over target (return address, stack depth)
+    std::string stopMessage;
+
+    StopReason stop(StopReason reason, const std::string &message);
+
+public:
+    void addBreakpoint(uint16_t address) { breakpoints.insert(address); }
+    void removeBreakpoint(uint16_t address) { breakpoints.erase(address); }
+    void addWatchpoint(const Watchpoint &watchpoint) { watchpoints.push_back(watchpoint); }
+    void removeWatchpoint(const Watchpoint &watchpoint); // One watchpoint equal to this one
+    void addCondition(const RegisterCondition &condition) { conditions.push_back(condition); }
+    void clear(); // Remove all breakpoints, watchpoints and conditions
+    bool hasBreakpoint(uint16_t address) const { return breakpoints.count(address) != 0; }
+
+    // Whether the debug dispatch loop is needed
+    bool isActive() const { return !breakpoints.empty() || !watchpoints.empty() || !conditions.empty() || runTo; }
+
+    StopReason run(Chip8 &machine, uint32_t cycles); // Execute up to cycles instructions, stopping on a hit
+    StopReason step(Chip8 &machine); // Execute exactly one instruction
+    StopReason stepOver(Chip8 &machine); // Step, running 2NNN calls until they return (finishes in run())
+    const std::string &getStopMessage() const { return stopMessage; }
+};
+
+#endif //DEBUGGER_H
@@ -1,17 +1,20 @@
 #include "DisassemblyWindow.h"
 #include <stdexcept>
+#include <vector>
+#include "BitmapFont.h"
 
 DisassemblyWindow::DisassemblyWindow(const char* title, int x, int y, int width, int height) 
-    : window(nullptr), renderer(nullptr), font(nullptr) {
-    
-    // Initialize TTF if not already initialized
-    if (!TTF_WasInit() && TTF_Init() < 0) {
-        throw std::runtime_error(std::string("TTF Init Error: ") + TTF_GetError());
-    }
+    : title(title), x(x), y(y), width(width), height(height) {
+}
 
+DisassemblyWindow::~DisassemblyWindow() {
+    cleanup();
+}
+
+void DisassemblyWindow::open() {
     // Create window
     window = SDL_CreateWindow(
-        title,
+        title.c_str(),
         x, y, width, height,
         SDL_WINDOW_SHOWN
     );
@@ -27,30 +30,32 @@ DisassemblyWindow::DisassemblyWindow(const char* title, int x, int y, int width,
         throw std::runtime_error(std::string("Renderer creation error: ") + SDL_GetError());
     }
 
-    // Load font (using a system font path - modify for your system)
-    #ifdef _WIN32
-    const char* fontPath = "C:\\Windows\\Fonts\\consola.ttf";
-    #elif __APPLE__
-    const char* fontPath = "/System/Library/Fonts/Monaco.ttf";
-    #else  // Linux
-    const char* fontPath = "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf";
-    #endif
-
-    font = TTF_OpenFont(fontPath, 14);
-    if (!font) {
+    // Unpack the font into one texture: white glyph pixels, transparent elsewhere
+    constexpr int size = BitmapFont::GLYPH_SIZE;
+    constexpr int atlasWidth = BitmapFont::COUNT * size;
+    std::vector<Uint32> pixels(atlasWidth * size, 0);
+    for (int glyph = 0; glyph < BitmapFont::COUNT; glyph++) {
+        for (int row = 0; row < size; row++) {
+            for (int column = 0; column < size; column++) {
+                if (BitmapFont::GLYPHS[glyph][row] >> column & 1) {
+                    pixels[row * atlasWidth + glyph * size + column] = 0xFFFFFFFF;
+                }
+            }
+        }
+    }
+    glyphs = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, atlasWidth, size);
+    if (!glyphs) {
         cleanup();
-        throw std::runtime_error(std::string("Font loading error: ") + TTF_GetError());
+        throw std::runtime_error(std::string("Texture creation error: ") + SDL_GetError());
     }
-}
-
-DisassemblyWindow::~DisassemblyWindow() {
-    cleanup();
+    SDL_UpdateTexture(glyphs, nullptr, pixels.data(), atlasWidth * sizeof(Uint32));
+    SDL_SetTextureBlendMode(glyphs, SDL_BLENDMODE_BLEND);
 }
 
 void DisassemblyWindow::cleanup() {
-    if (font) {
-        TTF_CloseFont(font);
-        font = nullptr;
+    if (glyphs) {
+        SDL_DestroyTexture(glyphs);
+        glyphs = nullptr;
     }
     if (renderer) {
         SDL_DestroyRenderer(renderer);
@@ -71,40 +76,33 @@ void DisassemblyWindow::addInstruction(const std::string& instruction) {
 }
 
 void DisassemblyWindow::render() {
-    if (!window || !renderer || !font) return;
+    if (wasClosed || !SDL_WasInit(SDL_INIT_VIDEO)) return;
+    if (!window) open();
 
     // Clear window
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
 
     // Render each instruction
-    int y = PADDING;
+    int lineY = PADDING;
     for (const auto& [number, instruction] : instructions) {
         // Format with actual instruction number
         std::string lineText = std::to_string(number) + ": " + instruction;
-        renderText(lineText, y);
-        y += LINE_HEIGHT;
+        renderText(lineText, lineY);
+        lineY += LINE_HEIGHT;
     }
 
     SDL_RenderPresent(renderer);
 }
 
 void DisassemblyWindow::renderText(const std::string& text, int y) {
-    SDL_Color textColor = {255, 255, 255, 255}; // White text
-    // Use blended rendering for smooth, high-quality text
-    SDL_Surface* surface = TTF_RenderText_Blended(font, text.c_str(), textColor);
-    if (surface) {
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-        if (texture) {
-            SDL_Rect dstRect = {
-                PADDING,
-                y,
-                surface->w,
-                surface->h
-            };
-            SDL_RenderCopy(renderer, texture, nullptr, &dstRect);
-            SDL_DestroyTexture(texture);
+    constexpr int size = BitmapFont::GLYPH_SIZE;
+    SDL_Rect dstRect = {PADDING, y, size * GLYPH_SCALE, size * GLYPH_SCALE};
+    for (char c : text) {
+        if (c != ' ') {
+            SDL_Rect srcRect = {BitmapFont::index(c) * size, 0, size, size};
+            SDL_RenderCopy(renderer, glyphs, &srcRect, &dstRect);
         }
-        SDL_FreeSurface(surface);
+        dstRect.x += size * GLYPH_SCALE;
     }
 }
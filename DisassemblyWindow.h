@@ -2,7 +2,6 @@
 #define DISASSEMBLYWINDOW_H
 
 #include <SDL2/SDL.h>
-#include <SDL_ttf.h>
 #include <deque>
 #include <string>
 #include <utility>
@@ -15,9 +14,10 @@ public:
 
     void addInstruction(const std::string& instruction);
     void render();
-    bool isOpen() const { return window != nullptr && !wasClosed; }
+    bool isOpen() const { return !wasClosed; }
     void checkEvent(const SDL_Event& event) {
-        if (event.type == SDL_WINDOWEVENT && 
+        if (window &&
+            event.type == SDL_WINDOWEVENT &&
             event.window.event == SDL_WINDOWEVENT_CLOSE &&
             event.window.windowID == SDL_GetWindowID(window)) {
             wasClosed = true;
@@ -29,13 +29,19 @@ private:
     static constexpr size_t MAX_LINES = 25;
     static constexpr int LINE_HEIGHT = 24;
     static constexpr int PADDING = 15;
+    static constexpr int GLYPH_SCALE = 2;  // Embedded 8x8 font drawn at 16x16
 
-    SDL_Window* window;
-    SDL_Renderer* renderer;
-    TTF_Font* font;
+    // The window is opened by the first render() after the main window has initialized
+    // SDL video, so the emulator starts running without waiting for it
+    std::string title;
+    int x, y, width, height;
+    SDL_Window* window = nullptr;
+    SDL_Renderer* renderer = nullptr;
+    SDL_Texture* glyphs = nullptr;  // Every glyph side by side, built once from BitmapFont
     std::deque<std::pair<uint32_t, std::string>> instructions;  // <instruction number, text>
     uint32_t instructionCount = 0;  // Running instruction counter
 
+    void open();
     void cleanup();
     void renderText(const std::string& text, int y);
 };
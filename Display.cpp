@@ -0,0 +1,126 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "Display.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// OR `bits` (MSB-first, w wide) into a 128-bit row mask starting at column x
+void placeBits(uint32_t bits, int w, int x, uint64_t mask[Display::WORDS]) {
+    uint64_t aligned = static_cast<uint64_t>(bits) << (64 - w); // Leftmost sprite pixel in bit 63
+    if (x == 0) {
+        mask[0] |= aligned;
+    } else if (x < 64) {
+        mask[0] |= aligned >> x;
+        mask[1] |= aligned << (64 - x);
+    } else {
+        mask[1] |= aligned >> (x - 64);
+    }
+}
+
+}
+
+void Display::rehash() {
+    hash = 0;
+    for (int p = 0; p < PLANES; p++) {
+        for (int y = 0; y < MAX_HEIGHT; y++) {
+            for (int word = 0; word < WORDS; word++) {
+                hash += wordHash(p, y, word, planes[p][y][word]);
+            }
+        }
+    }
+}
+
+void Display::resize(int width, int height) {
+    this->width = width;
+    this->height = height;
+    clear();
+}
+
+bool Display::drawRow(int plane, int x, int y, uint16_t bits, int w, bool wrap) {
+    uint64_t mask[WORDS] = {0, 0};
+    uint32_t data = bits & ((1u << w) - 1);
+
+    // Pixels past the right edge either wrap to column 0 or are clipped
+    int overflow = x + w - width;
+    if (overflow > 0) {
+        if (wrap) {
+            placeBits(data & ((1u << overflow) - 1), overflow, 0, mask);
+        }
+        data >>= overflow;
+        w -= overflow;
+    }
+    placeBits(data, w, x, mask);
+
+    uint64_t *row = planes[plane][y];
+    bool collision = ((row[0] & mask[0]) | (row[1] & mask[1])) != 0;
+    hash -= wordHash(plane, y, 0, row[0]) + wordHash(plane, y, 1, row[1]);
+    row[0] ^= mask[0];
+    row[1] ^= mask[1];
+    hash += wordHash(plane, y, 0, row[0]) + wordHash(plane, y, 1, row[1]);
+    return collision;
+}
+
+void Display::clear(uint8_t planeMask) {
+    for (int p = 0; p < PLANES; p++) {
+        if (planeMask & (1 << p)) {
+            std::memset(planes[p], 0, sizeof(planes[p]));
+        }
+    }
+    rehash();
+}
+
+void Display::scrollDown(int n, uint8_t planeMask) {
+    n = std::min(n, height);
+    for (int p = 0; p < PLANES; p++) {
+        if (planeMask & (1 << p)) {
+            std::memmove(planes[p][n], planes[p][0], sizeof(planes[p][0]) * (height - n));
+            std::memset(planes[p][0], 0, sizeof(planes[p][0]) * n);
+        }
+    }
+    rehash();
+}
+
+void Display::scrollUp(int n, uint8_t planeMask) {
+    n = std::min(n, height);
+    for (int p = 0; p < PLANES; p++) {
+        if (planeMask & (1 << p)) {
+            std::memmove(planes[p][0], planes[p][n], sizeof(planes[p][0]) * (height - n));
+            std::memset(planes[p][height - n], 0, sizeof(planes[p][0]) * n);
+        }
+    }
+    rehash();
+}
+
+void Display::scrollRight(int n, uint8_t planeMask) {
+    for (int p = 0; p < PLANES; p++) {
+        if (!(planeMask & (1 << p))) {
+            continue;
+        }
+        for (int y = 0; y < height; y++) {
+            uint64_t *row = planes[p][y];
+            if (width > 64) {
+                row[1] = (row[1] >> n) | (row[0] << (64 - n));
+            }
+            row[0] >>= n;
+        }
+    }
+    rehash();
+}
+
+void Display::scrollLeft(int n, uint8_t planeMask) {
+    for (int p = 0; p < PLANES; p++) {
+        if (!(planeMask & (1 << p))) {
+            continue;
+        }
+        for (int y = 0; y < height; y++) {
+            uint64_t *row = planes[p][y];
+            row[0] = (row[0] << n) | (row[1] >> (64 - n));
+            row[1] <<= n;
+        }
+    }
+    rehash();
+}
@@ -0,0 +1,62 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <cstdint>
+#include "StateHash.h"
+
+/*
+ * Packed, plane-parallel framebuffer.
+ * Every bit plane stores each row as MAX_WIDTH bits in WORDS 64-bit words, leftmost pixel in the
+ * most significant bit. Drawing, collision and scrolling operate on whole words, so a 16 pixel
+ * sprite row costs the same handful of word operations on every selected plane.
+ * CHIP-8/SUPER-CHIP only use plane 0; XO-CHIP uses both planes (4 colors).
+ */
+class Display {
+public:
+    static constexpr int MAX_WIDTH = 128;
+    static constexpr int MAX_HEIGHT = 64;
+    static constexpr int PLANES = 2;
+    static constexpr int WORDS = MAX_WIDTH / 64; // 64-bit words per row
+
+private:
+    int width;
+    int height;
+    uint64_t hash = 0; // Sum of elementHash over every word, kept current by the drawing methods
+
+    static uint64_t wordHash(int plane, int y, int word, uint64_t value) {
+        return elementHash((plane * MAX_HEIGHT + y) * WORDS + word, value);
+    }
+
+public:
+    uint64_t planes[PLANES][MAX_HEIGHT][WORDS]{}; // Pixel data, plane -> row -> word (call rehash() after writing directly)
+
+    Display(int width, int height) : width(width), height(height) {}
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    void resize(int width, int height); // Change resolution and clear every plane
+    uint64_t getHash() const { return combineHash(hash, static_cast<uint64_t>(width) << 8 | height); } // Pixels and resolution
+    void rehash(); // Recompute the hash from scratch
+
+    // Plane bits of a pixel (bit 0 = plane 0, bit 1 = plane 1)
+    uint8_t getPixel(int x, int y) const {
+        int shift = 63 - (x & 63);
+        return static_cast<uint8_t>(((planes[0][y][x >> 6] >> shift) & 1) |
+                                    (((planes[1][y][x >> 6] >> shift) & 1) << 1));
+    }
+
+    // XOR one sprite row (MSB-first, w <= 16 bits wide) at (x, y) into a plane; returns true on collision
+    bool drawRow(int plane, int x, int y, uint16_t bits, int w, bool wrap);
+
+    void clear(uint8_t planeMask = 0xFF); // Clear selected planes
+    void scrollDown(int n, uint8_t planeMask = 0xFF); // Scroll selected planes down by n rows
+    void scrollUp(int n, uint8_t planeMask = 0xFF); // Scroll selected planes up by n rows
+    void scrollRight(int n, uint8_t planeMask = 0xFF); // Scroll selected planes right by n (< 64) pixels
+    void scrollLeft(int n, uint8_t planeMask = 0xFF); // Scroll selected planes left by n (< 64) pixels
+};
+
+#endif //DISPLAY_H
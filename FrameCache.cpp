@@ -0,0 +1,91 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "FrameCache.h"
+#include <stdexcept>
+#include <typeinfo>
+#include "StateHash.h"
+
+FrameCache::Origin::Origin(const Chip8 &machine)
+    : pc(machine.getPC()), index(machine.getIndex()), memoryHash(machine.getMemoryHash()),
+      displayHash(machine.display.getHash()) {
+    for (int reg = 0; reg < 16; reg++) {
+        V[reg] = machine.getV(reg);
+    }
+}
+
+FrameCache::FrameCache(size_t capacity, int instructionsPerFrame, bool verify)
+    : capacity(capacity), instructionsPerFrame(instructionsPerFrame), verify(verify) {
+    if (capacity == 0 || instructionsPerFrame < 1) {
+        throw std::runtime_error("Cache capacity and instructions per frame must be positive");
+    }
+}
+
+bool FrameCache::run(Chip8 &machine, const uint16_t *keys, size_t frames) {
+    uint64_t input = frames;
+    for (size_t f = 0; f < frames; f++) {
+        input = combineHash(input, keys[f]);
+    }
+    Key key{machine.stateHash(), input};
+    Origin origin(machine);
+
+    const uint64_t cycles = machine.getCycles();
+    std::shared_ptr<const Chip8> cached;
+    uint64_t elapsedCycles = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end() && typeid(*it->second.result) == typeid(machine)) {
+            const Entry &entry = it->second;
+            if (entry.origin == origin && (!entry.start || entry.start->sameState(machine))) {
+                recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, entry.recent);
+                cached = entry.result;
+                elapsedCycles = entry.cycles;
+            } else {
+                collisions++; // A different state with the same key: emulate, keep the entry
+            }
+        }
+    }
+    if (cached) {
+        machine.restore(*cached);
+        machine.setClock(cycles + elapsedCycles);
+        hits++;
+        return true;
+    }
+
+    std::shared_ptr<const Chip8> start = verify ? std::shared_ptr<const Chip8>(machine.clone()) : nullptr;
+    for (size_t f = 0; f < frames && !machine.isHalted(); f++) {
+        machine.setKeys(keys[f]);
+        machine.runFrame(instructionsPerFrame);
+    }
+    misses++;
+
+    std::shared_ptr<const Chip8> result = machine.clone();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.count(key)) {
+        return false; // Another thread stored the same chunk meanwhile
+    }
+    if (entries.size() == capacity) {
+        entries.erase(recentlyUsed.back());
+        recentlyUsed.pop_back();
+    }
+    recentlyUsed.push_front(key);
+    entries.emplace(key, Entry{origin, std::move(start), std::move(result), recentlyUsed.begin(),
+                               machine.getCycles() - cycles});
+    return false;
+}
+
+void FrameCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    recentlyUsed.clear();
+    hits = 0;
+    misses = 0;
+    collisions = 0;
+}
+
+size_t FrameCache::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
@@ -0,0 +1,84 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "Chip8.h"
+
+/*
+ * Memoized emulation for deterministic replays and search.
+ * Results are keyed by (Chip8::stateHash(), hash of the input chunk): running the same
+ * frames with the same key masks from a state seen before restores the stored result
+ * instead of emulating. Entries are machine snapshots, evicted least recently used first;
+ * the emulated clock is not part of the state, so a hit advances the machine's own clock.
+ * Lookups are thread-safe; emulation on a miss runs outside the lock.
+ *
+ * The cache is probabilistic: two states can share a 64-bit key. Every entry also keeps
+ * the registers and the memory and display hashes of the state it started from, and a
+ * hit must match them, so a collision would need the same registers and colliding memory
+ * or display hashes as well. With verify set, an entry keeps its whole starting state and
+ * a hit is compared with Chip8::sameState(), which rules collisions out at the cost of a
+ * snapshot per entry and a memory comparison per hit. Rejected hits are counted as
+ * collisions and emulated.
+ */
+class FrameCache {
+    struct Key {
+        uint64_t state;
+        uint64_t input;
+        bool operator==(const Key &other) const { return state == other.state && input == other.input; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const { return static_cast<size_t>(key.state ^ (key.input * 0x9E3779B97F4A7C15ULL)); }
+    };
+    // State a chunk started from, beyond the key
+    struct Origin {
+        uint16_t pc;
+        uint16_t index;
+        uint8_t V[16];
+        uint64_t memoryHash;
+        uint64_t displayHash;
+
+        explicit Origin(const Chip8 &machine);
+        bool operator==(const Origin &other) const = default;
+    };
+    struct Entry {
+        Origin origin;
+        std::shared_ptr<const Chip8> start; // Whole starting state, kept only with verify
+        std::shared_ptr<const Chip8> result; // Machine state after the chunk
+        std::list<Key>::iterator recent; // Position in the LRU list
+        uint64_t cycles; // Clock advance over the chunk, applied to the machine's own clock on a hit
+    };
+
+    size_t capacity;
+    int instructionsPerFrame;
+    bool verify; // Compare the full starting state on every hit
+    std::mutex mutex;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    std::list<Key> recentlyUsed; // Front: most recent
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> collisions{0};
+
+public:
+    FrameCache(size_t capacity, int instructionsPerFrame, bool verify = false);
+
+    // Run `frames` frames holding key mask keys[f] during frame f; returns true if the result came from the cache
+    bool run(Chip8 &machine, const uint16_t *keys, size_t frames);
+    void clear();
+
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+    uint64_t getCollisions() const { return collisions; } // Key matches rejected by the origin check (also counted as misses)
+    size_t size();
+};
+
+#endif //FRAMECACHE_H
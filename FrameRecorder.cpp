@@ -0,0 +1,143 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "FrameRecorder.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+int checkedScale(int scale) {
+    if (scale < 1) {
+        throw std::runtime_error("Recording scale must be positive");
+    }
+    return scale;
+}
+
+}
+
+FrameRecorder::FrameRecorder(const RecorderConfig &config)
+    : config(config),
+      width(Display::MAX_WIDTH * checkedScale(config.scale)),
+      height(Display::MAX_HEIGHT * config.scale),
+      lowRes(config.filter, config.scale * 2),
+      highRes(config.filter, config.scale),
+      lowResPixels(static_cast<size_t>(width) * height),
+      highResPixels(static_cast<size_t>(width) * height),
+      slots(std::max<size_t>(config.queueFrames, 1)) {
+    if (!config.videoPath.empty()) {
+        video = std::make_unique<Y4MWriter>(config.videoPath, width, height, 60);
+    }
+    lowRes.setPersistence(config.persistence);
+    highRes.setPersistence(config.persistence);
+    encoder = std::thread(&FrameRecorder::encode, this);
+}
+
+FrameRecorder::~FrameRecorder() {
+    try {
+        finish();
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "Recording error: %s\n", e.what());
+    }
+}
+
+void FrameRecorder::rethrow() {
+    if (error) {
+        std::exception_ptr pending = error;
+        error = nullptr;
+        std::rethrow_exception(pending);
+    }
+}
+
+void FrameRecorder::push(const Display &display) {
+    uint64_t frame = frames++;
+    if (!video && (!config.screenshotEvery || frame % config.screenshotEvery)) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    rethrow();
+    if (finishing) {
+        return;
+    }
+    if (queued == slots.size()) {
+        if (!config.lossless) {
+            dropped++;
+            return;
+        }
+        drained.wait(lock, [this] { return queued < slots.size() || error; });
+        rethrow();
+    }
+    Slot &slot = slots[(head + queued) % slots.size()];
+    lock.unlock();
+
+    // Only the emulation thread fills slots past the queue, so the copy runs unlocked
+    slot.display = display;
+    slot.frame = frame;
+
+    lock.lock();
+    queued++;
+    filled.notify_one();
+}
+
+void FrameRecorder::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (finishing) {
+            rethrow();
+            return;
+        }
+        finishing = true;
+        filled.notify_one();
+    }
+    encoder.join();
+    video.reset();
+    rethrow();
+}
+
+void FrameRecorder::encode() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        filled.wait(lock, [this] { return queued || finishing; });
+        if (!queued) {
+            return; // Finishing and drained
+        }
+        const Slot &slot = slots[head];
+        lock.unlock();
+
+        std::exception_ptr failure;
+        try {
+            write(slot);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+
+        lock.lock();
+        head = (head + 1) % slots.size();
+        queued--;
+        drained.notify_one();
+        if (failure) {
+            error = failure;
+            return; // Outputs are unusable, push() reports it
+        }
+    }
+}
+
+void FrameRecorder::write(const Slot &slot) {
+    const Display &display = slot.display;
+    bool low = display.getWidth() < Display::MAX_WIDTH;
+    Scaler &scaler = low ? lowRes : highRes;
+    std::vector<uint32_t> &pixels = low ? lowResPixels : highResPixels;
+    scaler.render(display, pixels.data(), width * sizeof(uint32_t));
+
+    if (video) {
+        video->write(pixels.data());
+    }
+    if (config.screenshotEvery && slot.frame % config.screenshotEvery == 0) {
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), "_%06llu.png", static_cast<unsigned long long>(slot.frame));
+        writeFile(config.screenshotPrefix + suffix, encodePNG(pixels.data(), width, height));
+    }
+}
@@ -0,0 +1,86 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef FRAMERECORDER_H
+#define FRAMERECORDER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Display.h"
+#include "ImageWriter.h"
+#include "Scaler.h"
+
+struct RecorderConfig {
+    std::string videoPath; // Y4M output, empty: no video
+    int screenshotEvery = 0; // Write a PNG every n frames, 0: none
+    std::string screenshotPrefix; // PNGs are <prefix>_<frame>.png
+    int scale = 4; // Output pixels per high-resolution pixel
+    ScaleFilter filter = ScaleFilter::Nearest;
+    uint8_t persistence = 0; // Phosphor persistence, see Scaler
+    size_t queueFrames = 256; // Frames buffered for the encoder
+    bool lossless = true; // Wait for the encoder when the queue is full instead of dropping the frame
+};
+
+/*
+ * Background video and screenshot writer.
+ * push() copies the packed framebuffer (2 KB) into a fixed ring of slots and returns;
+ * upscaling, color conversion, PNG compression and file I/O happen on the encoder thread.
+ * Output is always 128x64 times the scale, low-resolution frames are doubled.
+ * Encoder errors are rethrown by the next push() or finish().
+ */
+class FrameRecorder {
+    struct Slot {
+        Display display{Display::MAX_WIDTH, Display::MAX_HEIGHT};
+        uint64_t frame = 0;
+    };
+
+    RecorderConfig config;
+    int width; // Output size
+    int height;
+    std::unique_ptr<Y4MWriter> video;
+    Scaler lowRes; // Frames are scaled by the encoder thread only
+    Scaler highRes;
+    std::vector<uint32_t> lowResPixels; // Persistent scaler outputs
+    std::vector<uint32_t> highResPixels;
+
+    std::vector<Slot> slots;
+    size_t head = 0; // Next slot to encode
+    size_t queued = 0;
+    std::mutex mutex;
+    std::condition_variable filled; // Encoder: a frame was queued or the recorder is finishing
+    std::condition_variable drained; // Emulation: a slot was freed
+    bool finishing = false;
+    std::exception_ptr error;
+    uint64_t frames = 0; // Frames offered to push()
+    uint64_t dropped = 0;
+    std::thread encoder;
+
+    void encode(); // Encoder thread
+    void write(const Slot &slot);
+    void rethrow();
+
+public:
+    explicit FrameRecorder(const RecorderConfig &config);
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    void push(const Display &display); // Once per emulated frame
+    void finish(); // Encode the queued frames and close the outputs
+
+    uint64_t getFrames() const { return frames; }
+    uint64_t getDropped() const { return dropped; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+};
+
+#endif //FRAMERECORDER_H
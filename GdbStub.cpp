@@ -0,0 +1,485 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "GdbStub.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr int REGISTER_COUNT = 21; // V0-VF, I, PC, SP, DT, ST
+constexpr int REGISTER_BYTES[REGISTER_COUNT] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 1, 1, 1};
+
+const char TARGET_XML[] =
+    "<?xml version=\"1.0\"?><!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target><feature name=\"org.chip8.core\">"
+    "<reg name=\"v0\" bitsize=\"8\"/><reg name=\"v1\" bitsize=\"8\"/><reg name=\"v2\" bitsize=\"8\"/>"
+    "<reg name=\"v3\" bitsize=\"8\"/><reg name=\"v4\" bitsize=\"8\"/><reg name=\"v5\" bitsize=\"8\"/>"
+    "<reg name=\"v6\" bitsize=\"8\"/><reg name=\"v7\" bitsize=\"8\"/><reg name=\"v8\" bitsize=\"8\"/>"
+    "<reg name=\"v9\" bitsize=\"8\"/><reg name=\"va\" bitsize=\"8\"/><reg name=\"vb\" bitsize=\"8\"/>"
+    "<reg name=\"vc\" bitsize=\"8\"/><reg name=\"vd\" bitsize=\"8\"/><reg name=\"ve\" bitsize=\"8\"/>"
+    "<reg name=\"vf\" bitsize=\"8\"/><reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>"
+    "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/><reg name=\"sp\" bitsize=\"8\"/>"
+    "<reg name=\"dt\" bitsize=\"8\"/><reg name=\"st\" bitsize=\"8\"/>"
+    "</feature></target>";
+
+std::string toHex(const uint8_t *data, size_t length) {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < length; i++) {
+        out += DIGITS[data[i] >> 4];
+        out += DIGITS[data[i] & 0xF];
+    }
+    return out;
+}
+
+std::vector<uint8_t> fromHex(const std::string &text) {
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i + 1 < text.size(); i += 2) {
+        out.push_back(static_cast<uint8_t>(std::stoul(text.substr(i, 2), nullptr, 16)));
+    }
+    return out;
+}
+
+uint32_t readRegister(const Chip8 &machine, int reg) {
+    if (reg < 16) return machine.getV(reg);
+    switch (reg) {
+        case 16: return machine.getIndex();
+        case 17: return machine.getPC();
+        case 18: return machine.getSP();
+        case 19: return machine.getDelayTimer();
+        default: return machine.getSoundTimer();
+    }
+}
+
+void writeRegister(Chip8 &machine, int reg, uint32_t value) {
+    if (reg < 16) {
+        machine.setV(reg, static_cast<uint8_t>(value));
+        return;
+    }
+    switch (reg) {
+        case 16: machine.setIndex(static_cast<uint16_t>(value)); break;
+        case 17: machine.setPC(static_cast<uint16_t>(value)); break;
+        case 19: machine.setDelayTimer(static_cast<uint8_t>(value)); break;
+        case 20: machine.setSoundTimer(static_cast<uint8_t>(value)); break;
+        default: break; // SP is read-only
+    }
+}
+
+std::string encodeRegister(const Chip8 &machine, int reg) {
+    uint32_t value = readRegister(machine, reg);
+    uint8_t bytes[2] = {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8)};
+    return toHex(bytes, REGISTER_BYTES[reg]);
+}
+
+uint32_t decodeRegister(const std::vector<uint8_t> &bytes, size_t offset, int reg) {
+    uint32_t value = bytes[offset];
+    if (REGISTER_BYTES[reg] == 2) {
+        value |= bytes[offset + 1] << 8;
+    }
+    return value;
+}
+
+}
+
+GdbStub::GdbStub(uint16_t port) {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        throw std::runtime_error(std::string("GDB stub socket error: ") + std::strerror(errno));
+    }
+    int yes = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Local connections only
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listenFd, 1) < 0) {
+        close(listenFd);
+        throw std::runtime_error("GDB stub cannot listen on port " + std::to_string(port) + ": " + std::strerror(errno));
+    }
+    if (pipe(wakeFds) < 0) {
+        close(listenFd);
+        throw std::runtime_error(std::string("GDB stub pipe error: ") + std::strerror(errno));
+    }
+
+    thread = std::thread(&GdbStub::serve, this);
+}
+
+GdbStub::~GdbStub() {
+    stopping = true;
+    char wake = 0;
+    (void)!write(wakeFds[1], &wake, 1);
+    thread.join();
+    close(listenFd);
+    close(wakeFds[0]);
+    close(wakeFds[1]);
+}
+
+void GdbStub::serve() {
+    while (!stopping) {
+        pollfd fds[2] = {{listenFd, POLLIN, 0}, {wakeFds[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) <= 0) {
+            continue;
+        }
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            (void)!read(wakeFds[0], drain, sizeof(drain));
+        }
+        if (fds[0].revents & POLLIN) {
+            int client = accept(listenFd, nullptr, nullptr);
+            if (client >= 0) {
+                handleClient(client);
+                close(client);
+            }
+        }
+    }
+}
+
+void GdbStub::handleClient(int fd) {
+    noAck = false;
+    startSession();
+
+    std::string input;
+    while (!stopping) {
+        pollfd fds[2] = {{fd, POLLIN, 0}, {wakeFds[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) <= 0) {
+            continue;
+        }
+
+        // Send replies queued by the emulation thread
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            (void)!read(wakeFds[0], drain, sizeof(drain));
+            std::deque<std::pair<uint32_t, std::string>> outgoing;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                outgoing.swap(replies);
+            }
+            for (const auto &[owner, payload] : outgoing) {
+                if (owner != session) {
+                    continue; // Answer to a client that has gone
+                }
+                uint8_t checksum = 0;
+                for (char c : payload) {
+                    checksum += static_cast<uint8_t>(c);
+                }
+                std::stringstream packet;
+                packet << '$' << payload << '#' << std::hex << std::setfill('0') << std::setw(2) << +checksum;
+                std::string data = packet.str();
+                if (send(fd, data.data(), data.size(), MSG_NOSIGNAL) < 0) {
+                    break;
+                }
+            }
+        }
+
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            continue;
+        }
+        char buffer[4096];
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            break; // Client went away
+        }
+        input.append(buffer, received);
+
+        // Split the stream into packets: $payload#cs, with Ctrl-C as an out-of-band interrupt
+        while (!input.empty()) {
+            if (input[0] == '\x03') {
+                queueCommand("\x03");
+                input.erase(0, 1);
+            } else if (input[0] != '$') {
+                input.erase(0, 1); // '+'/'-' acknowledgements and noise
+            } else {
+                size_t hash = input.find('#');
+                if (hash == std::string::npos || input.size() < hash + 3) {
+                    break; // Incomplete packet
+                }
+                std::string payload = input.substr(1, hash - 1);
+                uint8_t checksum = 0;
+                for (char c : payload) {
+                    checksum += static_cast<uint8_t>(c);
+                }
+                bool valid = checksum == std::stoul(input.substr(hash + 1, 2), nullptr, 16);
+                input.erase(0, hash + 3);
+                if (!noAck) {
+                    send(fd, valid ? "+" : "-", 1, MSG_NOSIGNAL);
+                }
+                if (!valid) {
+                    continue;
+                }
+                if (payload == "QStartNoAckMode") {
+                    send(fd, "$OK#9a", 6, MSG_NOSIGNAL);
+                    noAck = true;
+                    continue;
+                }
+                queueCommand(payload);
+            }
+        }
+    }
+
+    // Packets the emulation thread has not handled yet have nobody to answer to
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.clear();
+        replies.clear();
+    }
+    queueCommand("!detach");
+}
+
+void GdbStub::startSession() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        session++;
+        replies.clear();
+    }
+    queueCommand("!attach");
+}
+
+void GdbStub::queueCommand(std::string command) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.emplace_back(session, std::move(command));
+        pending.store(true, std::memory_order_release);
+    }
+    commandReady.notify_one();
+}
+
+void GdbStub::reply(const std::string &payload) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        replies.emplace_back(replySession, payload);
+    }
+    char wake = 1;
+    (void)!write(wakeFds[1], &wake, 1);
+}
+
+void GdbStub::waitForCommand(int milliseconds) {
+    std::unique_lock<std::mutex> lock(mutex);
+    commandReady.wait_for(lock, std::chrono::milliseconds(milliseconds), [this] { return !commands.empty(); });
+}
+
+void GdbStub::notifyStop(StopReason reason) {
+    if (reason == StopReason::None || halted || !attached) {
+        return;
+    }
+    halted = true;
+    reply("S05"); // SIGTRAP
+}
+
+void GdbStub::service(Chip8 &machine, Debugger &debugger) {
+    if (!pending.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::deque<std::pair<uint32_t, std::string>> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(commands);
+        pending.store(false, std::memory_order_relaxed);
+    }
+    for (const auto &[owner, command] : batch) {
+        replySession = owner;
+        handle(command, machine, debugger);
+    }
+}
+
+void GdbStub::detach(Debugger &debugger) {
+    // Only what the client added; breakpoints from the command line stay
+    for (uint16_t address : breakpoints) {
+        debugger.removeBreakpoint(address);
+    }
+    for (const Watchpoint &watchpoint : watchpoints) {
+        debugger.removeWatchpoint(watchpoint);
+    }
+    breakpoints.clear();
+    watchpoints.clear();
+    attached = false;
+    halted = false;
+}
+
+void GdbStub::handle(const std::string &command, Chip8 &machine, Debugger &debugger) {
+    if (command == "!attach") {
+        attached = true;
+        halted = true; // GDB expects a stopped target
+        return;
+    }
+    if (command == "!detach") {
+        detach(debugger);
+        return;
+    }
+    if (command == "\x03") {
+        if (!halted) {
+            halted = true;
+            reply("S02"); // SIGINT
+        }
+        return;
+    }
+
+    try {
+        char type = command[0];
+        std::string args = command.substr(1);
+        switch (type) {
+            case '?':
+                reply("S05");
+                return;
+            case 'g': {
+                std::string registers;
+                for (int reg = 0; reg < REGISTER_COUNT; reg++) {
+                    registers += encodeRegister(machine, reg);
+                }
+                reply(registers);
+                return;
+            }
+            case 'G': {
+                std::vector<uint8_t> bytes = fromHex(args);
+                size_t offset = 0;
+                for (int reg = 0; reg < REGISTER_COUNT && offset + REGISTER_BYTES[reg] <= bytes.size(); reg++) {
+                    writeRegister(machine, reg, decodeRegister(bytes, offset, reg));
+                    offset += REGISTER_BYTES[reg];
+                }
+                reply("OK");
+                return;
+            }
+            case 'p': {
+                int reg = std::stoi(args, nullptr, 16);
+                reply(reg < REGISTER_COUNT ? encodeRegister(machine, reg) : "E01");
+                return;
+            }
+            case 'P': {
+                size_t eq = args.find('=');
+                int reg = std::stoi(args.substr(0, eq), nullptr, 16);
+                if (reg >= REGISTER_COUNT) {
+                    reply("E01");
+                    return;
+                }
+                writeRegister(machine, reg, decodeRegister(fromHex(args.substr(eq + 1)), 0, reg));
+                reply("OK");
+                return;
+            }
+            case 'm':
+            case 'M': {
+                size_t comma = args.find(',');
+                size_t colon = args.find(':');
+                uint32_t address = std::stoul(args.substr(0, comma), nullptr, 16);
+                uint32_t length = std::stoul(args.substr(comma + 1, colon - comma - 1), nullptr, 16);
+                if (address + length > machine.memorySize()) {
+                    reply("E01");
+                    return;
+                }
+                if (type == 'm') {
+                    std::vector<uint8_t> bytes(length);
+                    for (uint32_t i = 0; i < length; i++) {
+                        bytes[i] = machine.readMemory(static_cast<uint16_t>(address + i));
+                    }
+                    reply(toHex(bytes.data(), bytes.size()));
+                } else {
+                    std::vector<uint8_t> bytes = fromHex(args.substr(colon + 1));
+                    for (uint32_t i = 0; i < length && i < bytes.size(); i++) {
+                        machine.writeMemory(static_cast<uint16_t>(address + i), bytes[i]);
+                    }
+                    reply("OK");
+                }
+                return;
+            }
+            case 'c':
+                if (!args.empty()) {
+                    machine.setPC(static_cast<uint16_t>(std::stoul(args, nullptr, 16)));
+                }
+                halted = false; // Stop reply follows when the debugger stops
+                return;
+            case 's':
+                if (!args.empty()) {
+                    machine.setPC(static_cast<uint16_t>(std::stoul(args, nullptr, 16)));
+                }
+                debugger.step(machine);
+                reply("S05");
+                return;
+            case 'Z':
+            case 'z': {
+                // Z0/Z1 breakpoint, Z2 write, Z3 read, Z4 access watchpoint: "Zt,addr,kind"
+                int kind = args[0] - '0';
+                size_t comma = args.find(',', 2);
+                uint16_t address = static_cast<uint16_t>(std::stoul(args.substr(2, comma - 2), nullptr, 16));
+                uint16_t length = static_cast<uint16_t>(std::stoul(args.substr(comma + 1), nullptr, 16));
+                if (kind < 0 || kind > 4) {
+                    reply("");
+                    return;
+                }
+                Watchpoint watchpoint{address, std::max<uint16_t>(length, 1), kind != 2, kind != 3};
+                if (kind <= 1 && type == 'Z') {
+                    if (!debugger.hasBreakpoint(address)) { // Otherwise the user's, and it stays theirs
+                        debugger.addBreakpoint(address);
+                        breakpoints.insert(address);
+                    }
+                } else if (kind <= 1) {
+                    if (breakpoints.erase(address)) {
+                        debugger.removeBreakpoint(address);
+                    }
+                } else if (type == 'Z') {
+                    debugger.addWatchpoint(watchpoint);
+                    watchpoints.push_back(watchpoint);
+                } else {
+                    auto it = std::find(watchpoints.begin(), watchpoints.end(), watchpoint);
+                    if (it != watchpoints.end()) {
+                        watchpoints.erase(it);
+                        debugger.removeWatchpoint(watchpoint);
+                    }
+                }
+                reply("OK");
+                return;
+            }
+            case 'D':
+                reply("OK");
+                detach(debugger);
+                return;
+            case 'k':
+                detach(debugger);
+                return;
+            case 'H':
+            case 'T':
+                reply("OK");
+                return;
+            case 'q':
+                if (command.rfind("qSupported", 0) == 0) {
+                    reply("PacketSize=4000;qXfer:features:read+;QStartNoAckMode+");
+                } else if (command == "qAttached") {
+                    reply("1");
+                } else if (command == "qC") {
+                    reply("QC1");
+                } else if (command == "qfThreadInfo") {
+                    reply("m1");
+                } else if (command == "qsThreadInfo") {
+                    reply("l");
+                } else if (command.rfind("qXfer:features:read:target.xml:", 0) == 0) {
+                    std::string range = command.substr(std::strlen("qXfer:features:read:target.xml:"));
+                    size_t comma = range.find(',');
+                    size_t offset = std::stoul(range.substr(0, comma), nullptr, 16);
+                    size_t length = std::stoul(range.substr(comma + 1), nullptr, 16);
+                    std::string xml(TARGET_XML);
+                    if (offset >= xml.size()) {
+                        reply("l");
+                    } else {
+                        std::string chunk = xml.substr(offset, length);
+                        reply((offset + chunk.size() >= xml.size() ? "l" : "m") + chunk);
+                    }
+                } else {
+                    reply("");
+                }
+                return;
+            default:
+                reply(""); // Unsupported
+                return;
+        }
+    } catch (const std::exception &) {
+        reply("E02"); // Malformed packet
+    }
+}
@@ -0,0 +1,76 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef GDBSTUB_H
+#define GDBSTUB_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Chip8.h"
+#include "Debugger.h"
+
+/*
+ * GDB Remote Serial Protocol stub on a localhost TCP port.
+ * A background thread owns the socket: it accepts one client at a time, checks and
+ * acknowledges packets and queues them for the emulation thread. The emulation thread
+ * calls service() between cycles; with nothing queued that is a single atomic load, so
+ * an attached but idle debugger costs nothing while the machine runs freely.
+ *
+ * Register layout (g/G/p/P), little endian: V0-VF (16 x 8 bit), I (16), PC (16),
+ * SP (8), DT (8), ST (8). Memory (m/M) is the machine's address space.
+ * Supported: ?, g, G, p, P, m, M, c, s, Z0-Z4, z0-z4, D, k, Ctrl-C, qSupported,
+ * qXfer:features:read:target.xml, QStartNoAckMode.
+ */
+class GdbStub {
+    int listenFd = -1;
+    int wakeFds[2] = {-1, -1}; // Pipe that wakes the socket thread when replies are queued
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+
+    std::mutex mutex;
+    std::condition_variable commandReady;
+    // Both queues are tagged with the client connection they belong to, so nothing left
+    // over from one client reaches the next
+    std::deque<std::pair<uint32_t, std::string>> commands; // Packet payloads for the emulation thread
+    std::deque<std::pair<uint32_t, std::string>> replies; // Payloads for the socket thread to send
+    std::atomic<bool> pending{false}; // commands is non-empty
+
+    bool attached = false; // Emulation thread only
+    bool halted = false; // Emulation thread only
+    uint32_t replySession = 0; // Emulation thread only: connection of the command being handled
+    std::set<uint16_t> breakpoints; // Set by the client and not already set by the user, removed when it detaches
+    std::vector<Watchpoint> watchpoints; // Set by the client, removed when it detaches
+    uint32_t session = 0; // Socket thread only: connections accepted so far
+    bool noAck = false; // Socket thread only
+
+    void serve(); // Socket thread
+    void handleClient(int fd);
+    void queueCommand(std::string command);
+    void startSession(); // Socket thread: drop what is left from the previous client and attach
+    void reply(const std::string &payload);
+    void handle(const std::string &command, Chip8 &machine, Debugger &debugger);
+    void detach(Debugger &debugger);
+
+public:
+    explicit GdbStub(uint16_t port);
+    ~GdbStub();
+    GdbStub(const GdbStub&) = delete;
+    GdbStub& operator=(const GdbStub&) = delete;
+
+    void service(Chip8 &machine, Debugger &debugger); // Handle queued packets (emulation thread)
+    void notifyStop(StopReason reason); // Report a debugger stop to a running client
+    bool isHalted() const { return halted; } // Client wants the machine stopped
+    bool isConnected() const { return attached; }
+    void waitForCommand(int milliseconds); // Sleep until a packet arrives or the timeout expires
+};
+
+#endif //GDBSTUB_H
@@ -0,0 +1,233 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "ImageWriter.h"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace {
+
+struct CrcTable {
+    uint32_t values[256]{};
+
+    constexpr CrcTable() {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            values[n] = c;
+        }
+    }
+};
+
+constexpr CrcTable CRC;
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t n = 0; n < size; n++) {
+        crc = CRC.values[(crc ^ data[n]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t adler32(const std::vector<uint8_t> &data) {
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : data) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    return b << 16 | a;
+}
+
+void putBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Deflate bit stream, least significant bit first
+class BitWriter {
+    std::vector<uint8_t> &out;
+    uint32_t buffer = 0;
+    int count = 0;
+
+public:
+    explicit BitWriter(std::vector<uint8_t> &out) : out(out) {}
+
+    void bits(uint32_t value, int length) {
+        buffer |= value << count;
+        count += length;
+        while (count >= 8) {
+            out.push_back(static_cast<uint8_t>(buffer));
+            buffer >>= 8;
+            count -= 8;
+        }
+    }
+
+    // Huffman codes are stored most significant bit first
+    void code(uint32_t value, int length) {
+        uint32_t reversed = 0;
+        for (int n = 0; n < length; n++) {
+            reversed = reversed << 1 | ((value >> n) & 1);
+        }
+        bits(reversed, length);
+    }
+
+    void flush() {
+        if (count) {
+            out.push_back(static_cast<uint8_t>(buffer));
+        }
+        buffer = 0;
+        count = 0;
+    }
+};
+
+// Fixed Huffman literal/length alphabet (RFC 1951, 3.2.6)
+void putSymbol(BitWriter &writer, int symbol) {
+    if (symbol < 144) {
+        writer.code(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        writer.code(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        writer.code(symbol - 256, 7);
+    } else {
+        writer.code(0xC0 + symbol - 280, 8);
+    }
+}
+
+constexpr std::array<uint16_t, 29> LENGTH_BASE = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<uint8_t, 29> LENGTH_EXTRA = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr size_t MAX_MATCH = 258;
+
+void putMatch(BitWriter &writer, size_t length, int distance) {
+    int code = static_cast<int>(std::upper_bound(LENGTH_BASE.begin(), LENGTH_BASE.end(), length) - LENGTH_BASE.begin()) - 1;
+    putSymbol(writer, 257 + code);
+    writer.bits(static_cast<uint32_t>(length - LENGTH_BASE[code]), LENGTH_EXTRA[code]);
+    writer.code(distance - 1, 5); // Distances 1..4 have codes 0..3 without extra bits
+}
+
+/*
+ * zlib stream of one fixed-Huffman block.
+ * Upscaled screens are long runs of a few colors: matching only at distance 1 (a run of
+ * one byte) and at the pixel size (a run of one color) compresses them well without a
+ * hash chain or Huffman tables.
+ */
+std::vector<uint8_t> deflate(const std::vector<uint8_t> &data, int pixelSize) {
+    std::vector<uint8_t> out = {0x78, 0x01};
+    BitWriter writer(out);
+    writer.bits(1, 1); // Final block
+    writer.bits(1, 2); // Fixed Huffman codes
+
+    size_t size = data.size();
+    for (size_t i = 0; i < size;) {
+        size_t best = 0;
+        int bestDistance = 0;
+        for (int distance : {1, pixelSize}) {
+            if (i < static_cast<size_t>(distance)) {
+                continue;
+            }
+            size_t length = 0;
+            while (length < MAX_MATCH && i + length < size && data[i + length] == data[i + length - distance]) {
+                length++;
+            }
+            if (length > best) {
+                best = length;
+                bestDistance = distance;
+            }
+        }
+        if (best >= 3) {
+            putMatch(writer, best, bestDistance);
+            i += best;
+        } else {
+            putSymbol(writer, data[i++]);
+        }
+    }
+    putSymbol(writer, 256); // End of block
+    writer.flush();
+    putBigEndian(out, adler32(data));
+    return out;
+}
+
+void putChunk(std::vector<uint8_t> &png, const char *type, const std::vector<uint8_t> &data) {
+    putBigEndian(png, static_cast<uint32_t>(data.size()));
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    putBigEndian(png, crc32(png.data() + start, png.size() - start));
+}
+
+}
+
+std::vector<uint8_t> encodePNG(const uint32_t *pixels, int width, int height) {
+    constexpr int PIXEL_SIZE = 3;
+    size_t rowBytes = static_cast<size_t>(width) * PIXEL_SIZE;
+
+    // Scanlines with filter Up (None for the first): replicated rows become zeros
+    std::vector<uint8_t> raw;
+    raw.reserve((rowBytes + 1) * height);
+    std::vector<uint8_t> previous(rowBytes, 0), row(rowBytes);
+    for (int y = 0; y < height; y++) {
+        const uint32_t *in = pixels + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; x++) {
+            row[x * 3] = static_cast<uint8_t>(in[x] >> 16);
+            row[x * 3 + 1] = static_cast<uint8_t>(in[x] >> 8);
+            row[x * 3 + 2] = static_cast<uint8_t>(in[x]);
+        }
+        raw.push_back(y ? 2 : 0);
+        for (size_t n = 0; n < rowBytes; n++) {
+            raw.push_back(static_cast<uint8_t>(row[n] - previous[n]));
+        }
+        previous.swap(row);
+    }
+
+    std::vector<uint8_t> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, deflate, no interlace
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    putChunk(png, "IHDR", header);
+    putChunk(png, "IDAT", deflate(raw, PIXEL_SIZE));
+    putChunk(png, "IEND", {});
+    return png;
+}
+
+void writeFile(const std::string &path, const std::vector<uint8_t> &data) {
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        throw std::runtime_error("Unable to write " + path);
+    }
+}
+
+Y4MWriter::Y4MWriter(const std::string &path, int width, int height, int fps)
+    : file(path, std::ios::binary), width(width), height(height), planes(static_cast<size_t>(width) * height * 3) {
+    file << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C444\n";
+    if (!file) {
+        throw std::runtime_error("Unable to write " + path);
+    }
+}
+
+void Y4MWriter::write(const uint32_t *pixels) {
+    size_t count = static_cast<size_t>(width) * height;
+    uint8_t *y = planes.data();
+    uint8_t *u = y + count;
+    uint8_t *v = u + count;
+    for (size_t n = 0; n < count; n++) {
+        int r = (pixels[n] >> 16) & 0xFF, g = (pixels[n] >> 8) & 0xFF, b = pixels[n] & 0xFF;
+        y[n] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        u[n] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v[n] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+    file << "FRAME\n";
+    file.write(reinterpret_cast<const char *>(planes.data()), static_cast<std::streamsize>(planes.size()));
+    if (!file) {
+        throw std::runtime_error("Unable to write video frame");
+    }
+}
@@ -0,0 +1,34 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// PNG image (8-bit RGB) of width x height ARGB8888 pixels
+std::vector<uint8_t> encodePNG(const uint32_t *pixels, int width, int height);
+
+void writeFile(const std::string &path, const std::vector<uint8_t> &data);
+
+/*
+ * Raw YUV4MPEG2 video (4:4:4, 8 bit), readable by ffmpeg, mpv and most encoders.
+ * Every frame is converted from ARGB8888 with the BT.601 studio-range matrix.
+ */
+class Y4MWriter {
+    std::ofstream file;
+    int width;
+    int height;
+    std::vector<uint8_t> planes; // Y, U and V of one frame
+
+public:
+    Y4MWriter(const std::string &path, int width, int height, int fps);
+
+    void write(const uint32_t *pixels); // width x height ARGB8888 pixels
+};
+
+#endif //IMAGEWRITER_H
@@ -0,0 +1,37 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "MachineArena.h"
+#include <stdexcept>
+
+MachineArena::MachineArena(const Chip8 &prototype, size_t count)
+    : prototype(prototype.clone()), machineSize(prototype.objectSize()) {
+
+    storage = static_cast<std::byte *>(::operator new(machineSize * count, std::align_val_t(CACHE_LINE_SIZE)));
+    try {
+        for (; this->count < count; this->count++) {
+            std::byte *at = storage + this->count * machineSize;
+            if (static_cast<void *>(prototype.cloneInto(at)) != at) {
+                this->count++;
+                throw std::logic_error("Core base class is not at the start of the object");
+            }
+        }
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+MachineArena::~MachineArena() {
+    release();
+}
+
+void MachineArena::release() {
+    for (size_t i = 0; i < count; i++) {
+        (*this)[i].~Chip8();
+    }
+    ::operator delete(storage, std::align_val_t(CACHE_LINE_SIZE));
+    storage = nullptr;
+    count = 0;
+}
@@ -0,0 +1,44 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef MACHINEARENA_H
+#define MACHINEARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include "Chip8.h"
+
+/*
+ * N machines of one core type in a single cache-line-aligned allocation.
+ * Every instance starts as a copy of the prototype and reset() copies it back, which
+ * touches no allocator: machines have no heap-allocated members. Consecutive machines
+ * are stride() bytes apart, so a field of every instance is a strided view of the arena.
+ */
+class MachineArena {
+    std::unique_ptr<Chip8> prototype; // State reset() returns to
+    size_t count = 0;
+    size_t machineSize; // sizeof the concrete core, a multiple of CACHE_LINE_SIZE
+    std::byte *storage = nullptr;
+
+    void release();
+
+public:
+    MachineArena(const Chip8 &prototype, size_t count);
+    ~MachineArena();
+
+    MachineArena(const MachineArena&) = delete;
+    MachineArena& operator=(const MachineArena&) = delete;
+
+    size_t size() const { return count; }
+    size_t stride() const { return machineSize; } // Bytes between consecutive machines
+    const Chip8 &getPrototype() const { return *prototype; }
+
+    Chip8 &operator[](size_t i) { return *std::launder(reinterpret_cast<Chip8 *>(storage + i * machineSize)); }
+    const Chip8 &operator[](size_t i) const { return *std::launder(reinterpret_cast<const Chip8 *>(storage + i * machineSize)); }
+
+    void reset(size_t i) { (*this)[i].restore(*prototype); } // Instance i back to the prototype
+};
+
+#endif //MACHINEARENA_H
@@ -0,0 +1,330 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "NetPlay.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x504E3843; // "C8NP"
+constexpr uint8_t PACKET_HELLO = 1;
+constexpr uint8_t PACKET_INPUT = 2;
+constexpr uint8_t PACKET_QUIT = 3;
+constexpr int MAX_INPUTS = 32; // Unacknowledged inputs carried by one packet
+constexpr int HELLO_INTERVAL_MS = 100;
+
+using Clock = std::chrono::steady_clock;
+
+std::runtime_error systemError(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// Little-endian packet encoding, independent of the host
+class Writer {
+    uint8_t bytes[32 + 2 * MAX_INPUTS]{};
+    size_t length = 0;
+
+public:
+    void put(uint64_t value, int size) {
+        for (int i = 0; i < size; i++) {
+            bytes[length++] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+    const uint8_t *data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+class Reader {
+    const uint8_t *bytes;
+    size_t length;
+    size_t offset = 0;
+
+public:
+    Reader(const uint8_t *bytes, size_t length) : bytes(bytes), length(length) {}
+
+    bool has(size_t size) const { return offset + size <= length; }
+    uint64_t get(int size) {
+        uint64_t value = 0;
+        for (int i = 0; i < size && offset < length; i++) {
+            value |= static_cast<uint64_t>(bytes[offset++]) << (8 * i);
+        }
+        return value;
+    }
+};
+
+Writer header(uint8_t type, int player) {
+    Writer out;
+    out.put(MAGIC, 4);
+    out.put(type, 1);
+    out.put(static_cast<uint8_t>(player), 1);
+    return out;
+}
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}
+
+NetPlay::NetPlay(const NetPlayConfig &config, uint64_t romHash) : config(config), romHash(romHash) {
+    if (config.player != 1 && config.player != 2) {
+        throw std::runtime_error("Netplay player must be 1 or 2");
+    }
+    if (config.maxRollback < 1 || config.maxRollback > 16) {
+        throw std::runtime_error("Netplay rollback window must be 1-16 frames");
+    }
+
+    size_t colon = config.peer.rfind(':');
+    if (colon == std::string::npos || colon == 0) {
+        throw std::runtime_error("Netplay peer must be host:port, got " + config.peer);
+    }
+    std::string host = config.peer.substr(0, colon);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    std::string service = config.peer.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *peer = nullptr;
+    if (int error = getaddrinfo(host.c_str(), service.c_str(), &hints, &peer); error != 0) {
+        throw std::runtime_error("Unable to resolve " + config.peer + ": " + gai_strerror(error));
+    }
+
+    fd = socket(peer->ai_family, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        freeaddrinfo(peer);
+        throw systemError("Unable to create netplay socket");
+    }
+    sockaddr_storage local{};
+    local.ss_family = static_cast<sa_family_t>(peer->ai_family);
+    // The port sits at the same offset in sockaddr_in and sockaddr_in6
+    uint16_t port = htons(config.port);
+    std::memcpy(reinterpret_cast<uint8_t *>(&local) + offsetof(sockaddr_in, sin_port), &port, sizeof(port));
+    // Connecting the socket makes the kernel drop datagrams from anyone but the peer
+    bool ready = bind(fd, reinterpret_cast<sockaddr *>(&local), static_cast<socklen_t>(peer->ai_addrlen)) == 0 &&
+                 ::connect(fd, peer->ai_addr, peer->ai_addrlen) == 0 &&
+                 fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0;
+    freeaddrinfo(peer);
+    if (!ready) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        throw systemError("Unable to open netplay port " + std::to_string(config.port));
+    }
+}
+
+NetPlay::~NetPlay() {
+    Writer out = header(PACKET_QUIT, config.player);
+    // Unacknowledged, so said a few times
+    for (int i = 0; i < 3; i++) {
+        send(out.data(), out.size());
+    }
+    close(fd);
+}
+
+void NetPlay::send(const uint8_t *data, size_t size) {
+    // A full buffer or an unreachable peer only loses this packet; the next one repeats it
+    ::send(fd, data, size, 0);
+}
+
+void NetPlay::sendInputs() {
+    uint32_t first = std::max(peerAcked, frame > HISTORY ? frame - HISTORY : 0);
+    uint32_t count = std::min<uint32_t>(frame - first, MAX_INPUTS);
+    Writer out = header(PACKET_INPUT, config.player);
+    out.put(first, 4);
+    out.put(count, 1);
+    out.put(remoteFrames, 4);
+    out.put(lastConfirmed, 4);
+    out.put(confirmedHashes[lastConfirmed % HISTORY], 8);
+    for (uint32_t f = first; f < first + count; f++) {
+        out.put(localInputs[f % HISTORY], 2);
+    }
+    send(out.data(), out.size());
+}
+
+uint32_t NetPlay::connect(const Chip8 &machine) {
+    snapshots = std::make_unique<MachineArena>(machine, config.maxRollback + 1);
+    uint32_t seed = config.seed;
+    bool heardPeer = false;
+    bool peerReady = false; // The peer has our hello, or is already sending inputs
+    auto start = Clock::now();
+    auto lastHello = start - std::chrono::milliseconds(HELLO_INTERVAL_MS);
+
+    while (!heardPeer || !peerReady) {
+        if (millisecondsSince(start) > config.timeoutMs) {
+            throw std::runtime_error("No answer from netplay peer " + config.peer);
+        }
+        if (millisecondsSince(lastHello) >= HELLO_INTERVAL_MS) {
+            Writer out = header(PACKET_HELLO, config.player);
+            out.put(heardPeer, 1);
+            out.put(static_cast<uint8_t>(machine.getMode()), 1);
+            out.put(romHash, 8);
+            out.put(seed, 4);
+            send(out.data(), out.size());
+            lastHello = Clock::now();
+        }
+
+        pollfd waiting{fd, POLLIN, 0};
+        poll(&waiting, 1, HELLO_INTERVAL_MS / 4);
+        uint8_t packet[512];
+        ssize_t length;
+        while ((length = recv(fd, packet, sizeof(packet), 0)) >= 0) {
+            Reader in(packet, static_cast<size_t>(length));
+            if (!in.has(6) || in.get(4) != MAGIC) continue;
+            uint8_t type = static_cast<uint8_t>(in.get(1));
+            int player = static_cast<int>(in.get(1));
+            if (player == config.player) {
+                throw std::runtime_error("Both netplay peers are player " + std::to_string(player));
+            }
+            if (type == PACKET_INPUT) {
+                // The peer finished its handshake; the inputs themselves are sent again
+                peerReady = peerReady || heardPeer;
+            } else if (type == PACKET_HELLO && in.has(14)) {
+                bool ready = in.get(1);
+                peerReady = peerReady || ready;
+                if (static_cast<Mode>(in.get(1)) != machine.getMode()) {
+                    throw std::runtime_error("Netplay peer runs a different platform");
+                }
+                if (in.get(8) != romHash) {
+                    throw std::runtime_error("Netplay peer runs a different ROM");
+                }
+                uint32_t peerSeed = static_cast<uint32_t>(in.get(4));
+                if (player == 1) {
+                    seed = peerSeed;
+                }
+                if (!heardPeer) {
+                    heardPeer = true;
+                    lastHello = start - std::chrono::milliseconds(HELLO_INTERVAL_MS); // Answer right away
+                }
+            } else if (type == PACKET_QUIT) {
+                throw std::runtime_error("Netplay peer quit");
+            }
+        }
+    }
+
+    // Let a peer still waiting for our readiness finish before the first input arrives
+    Writer out = header(PACKET_HELLO, config.player);
+    out.put(1, 1);
+    out.put(static_cast<uint8_t>(machine.getMode()), 1);
+    out.put(romHash, 8);
+    out.put(seed, 4);
+    send(out.data(), out.size());
+    lastHeard = Clock::now();
+    return seed;
+}
+
+void NetPlay::receive(Chip8 &machine) {
+    uint32_t rollbackFrom = frame;
+    uint8_t packet[512];
+    ssize_t length;
+    while ((length = recv(fd, packet, sizeof(packet), 0)) >= 0) {
+        Reader in(packet, static_cast<size_t>(length));
+        if (!in.has(6) || in.get(4) != MAGIC) continue;
+        uint8_t type = static_cast<uint8_t>(in.get(1));
+        if (static_cast<int>(in.get(1)) == config.player) continue;
+        lastHeard = Clock::now();
+
+        if (type == PACKET_QUIT) {
+            peerQuit = true;
+            continue;
+        }
+        if (type != PACKET_INPUT || !in.has(21)) continue; // Hellos repeated by a slower peer
+
+        uint32_t first = static_cast<uint32_t>(in.get(4));
+        uint32_t count = static_cast<uint32_t>(in.get(1));
+        uint32_t acked = static_cast<uint32_t>(in.get(4));
+        uint32_t checkFrame = static_cast<uint32_t>(in.get(4));
+        uint64_t checkHash = in.get(8);
+        if (!in.has(2 * count)) continue;
+
+        peerAcked = std::max(peerAcked, std::min(acked, frame));
+        for (uint32_t f = first; f < first + count; f++) {
+            uint16_t keys = static_cast<uint16_t>(in.get(2));
+            // Only the next missing frame is taken, so the received inputs stay a prefix
+            if (f != remoteFrames || f + config.maxRollback >= frame + HISTORY) continue;
+            remoteInputs[f % HISTORY] = keys;
+            remoteFrames++;
+            if (f < frame && usedRemote[f % HISTORY] != keys) {
+                rollbackFrom = std::min(rollbackFrom, f);
+            }
+        }
+        if (checkFrame && hashedFrames[checkFrame % HISTORY] == checkFrame + 1 &&
+            confirmedHashes[checkFrame % HISTORY] != checkHash) {
+            desynced = true;
+        }
+    }
+    if (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNREFUSED && errno != EINTR) {
+        throw systemError("Netplay receive failed");
+    }
+
+    if (rollbackFrom < frame) {
+        auto start = Clock::now();
+        uint32_t present = frame;
+        machine.restore((*snapshots)[rollbackFrom % snapshots->size()]);
+        frame = rollbackFrom;
+        while (frame < present) {
+            simulate(machine);
+        }
+        stats.rollbacks++;
+        stats.resimulatedFrames += present - rollbackFrom;
+        stats.worstRollbackMs = std::max(stats.worstRollbackMs, millisecondsSince(start));
+    }
+}
+
+void NetPlay::simulate(Chip8 &machine) {
+    uint32_t f = frame;
+    uint16_t remote = 0;
+    if (f < remoteFrames) {
+        remote = remoteInputs[f % HISTORY];
+    } else if (remoteFrames) {
+        remote = remoteInputs[(remoteFrames - 1) % HISTORY]; // Prediction: the peer holds its keys
+    }
+    usedRemote[f % HISTORY] = remote;
+    (*snapshots)[f % snapshots->size()].restore(machine);
+    machine.setKeys(localInputs[f % HISTORY] | remote);
+    machine.runFrame(config.instructionsPerFrame);
+    frame++;
+}
+
+void NetPlay::confirm(const Chip8 &machine) {
+    uint32_t confirmed = std::min(frame, remoteFrames);
+    if (confirmed <= lastConfirmed) return;
+    const Chip8 &state = confirmed == frame ? machine : (*snapshots)[confirmed % snapshots->size()];
+    hashedFrames[confirmed % HISTORY] = confirmed + 1;
+    confirmedHashes[confirmed % HISTORY] = state.stateHash();
+    lastConfirmed = confirmed;
+}
+
+bool NetPlay::advance(Chip8 &machine, uint16_t localKeys) {
+    receive(machine);
+    confirm(machine);
+    if (frame >= remoteFrames + config.maxRollback) {
+        stats.stalls++;
+        if (peerQuit) return false;
+        if (millisecondsSince(lastHeard) > config.timeoutMs) {
+            throw std::runtime_error("Netplay peer " + config.peer + " stopped responding");
+        }
+        sendInputs();
+        return false;
+    }
+
+    localInputs[frame % HISTORY] = localKeys;
+    simulate(machine);
+    confirm(machine);
+    sendInputs();
+    return true;
+}
@@ -0,0 +1,90 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Chip8.h"
+#include "MachineArena.h"
+
+struct NetPlayConfig {
+    uint16_t port = 0; // Local UDP port
+    std::string peer; // Other player, host:port
+    int player = 1; // Player 1 picks the seed
+    uint32_t seed = 1; // Used when this is player 1
+    int instructionsPerFrame = 8;
+    int maxRollback = 8; // Frames the simulation may run ahead of the peer's input (1-16)
+    int timeoutMs = 5000; // Give up when the peer is silent this long
+};
+
+/*
+ * Two-player netplay over UDP with rollback.
+ * Both processes run the same machine, one frame per advance(), with the keypad being the
+ * OR of both players' keys. The remote keys of a frame whose input has not arrived yet are
+ * predicted to repeat the last ones received; when the real input differs, the machine
+ * goes back to the snapshot taken before that frame and re-simulates up to the present.
+ * Snapshots of the last maxRollback frames live in a MachineArena, so taking and restoring
+ * one never allocates. If the peer falls further behind than that, advance() stalls.
+ *
+ * Every packet carries all local inputs the peer has not acknowledged (losing packets only
+ * delays input) and the state hash of the newest frame whose inputs are all known, which
+ * the peer compares with its own to detect a desync.
+ */
+class NetPlay {
+public:
+    struct Stats {
+        uint64_t rollbacks = 0;
+        uint64_t resimulatedFrames = 0;
+        uint64_t stalls = 0; // advance() calls that waited for the peer
+        double worstRollbackMs = 0; // Longest restore and re-simulation
+    };
+
+private:
+    static constexpr int HISTORY = 64; // Frames of input kept, a power of two
+
+    NetPlayConfig config;
+    uint64_t romHash;
+    int fd = -1;
+
+    std::unique_ptr<MachineArena> snapshots; // State before frame f at f % (maxRollback + 1)
+    uint16_t localInputs[HISTORY]{}; // By frame % HISTORY
+    uint16_t remoteInputs[HISTORY]{};
+    uint16_t usedRemote[HISTORY]{}; // Remote keys a frame was last simulated with
+    uint32_t frame = 0; // Frames simulated
+    uint32_t remoteFrames = 0; // Remote inputs received, always a prefix
+    uint32_t peerAcked = 0; // Local inputs the peer has received
+    uint32_t hashedFrames[HISTORY]{}; // Confirmed frame whose hash is in confirmedHashes, +1 (0: none)
+    uint64_t confirmedHashes[HISTORY]{};
+    uint32_t lastConfirmed = 0;
+    bool desynced = false;
+    bool peerQuit = false;
+    std::chrono::steady_clock::time_point lastHeard;
+    Stats stats;
+
+    void send(const uint8_t *data, size_t size);
+    void sendInputs();
+    void receive(Chip8 &machine); // Drain the socket, rolling back on mispredictions
+    void simulate(Chip8 &machine); // Run the next frame, saving its snapshot first
+    void confirm(const Chip8 &machine); // Hash the newest frame with all inputs known
+
+public:
+    NetPlay(const NetPlayConfig &config, uint64_t romHash);
+    ~NetPlay();
+    NetPlay(const NetPlay&) = delete;
+    NetPlay& operator=(const NetPlay&) = delete;
+
+    uint32_t connect(const Chip8 &machine); // Handshake with the peer, returns the shared seed
+    bool advance(Chip8 &machine, uint16_t localKeys); // One frame; false if it had to wait for the peer
+
+    uint32_t getFrame() const { return frame; }
+    bool isDesynced() const { return desynced; }
+    bool hasPeerQuit() const { return peerQuit; }
+    const Stats &getStats() const { return stats; }
+};
+
+#endif //NETPLAY_H
@@ -0,0 +1,274 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef OPCODES_H
+#define OPCODES_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Opcode metadata shared by the decoder, the disassembler and the analysis tools.
+ * DECODE_TABLE maps every 16-bit instruction word to an Op at compile time, OP_INFO
+ * describes each Op: the platforms decodeOp() accepts it on, its length, the flags the
+ * analyzer follows and the disassembly format. Execution is the switch on Op in each
+ * core. Platform support is part of the metadata, so every core and tool agrees on what
+ * an instruction is.
+ */
+
+enum class Op : uint8_t {
+    Invalid,
+    Sys, // 0NNN
+    Cls, // 00E0
+    Ret, // 00EE
+    ScrollDown, // 00CN
+    ScrollUp, // 00DN
+    ScrollRight, // 00FB
+    ScrollLeft, // 00FC
+    Exit, // 00FD
+    LoRes, // 00FE
+    HiRes, // 00FF
+    Jump, // 1NNN
+    Call, // 2NNN
+    SkipEqImm, // 3XNN
+    SkipNeImm, // 4XNN
+    SkipEqReg, // 5XY0
+    SaveRange, // 5XY2
+    LoadRange, // 5XY3
+    LoadImm, // 6XNN
+    AddImm, // 7XNN
+    Move, // 8XY0
+    Or, // 8XY1
+    And, // 8XY2
+    Xor, // 8XY3
+    Add, // 8XY4
+    Sub, // 8XY5
+    Shr, // 8XY6
+    SubN, // 8XY7
+    Shl, // 8XYE
+    SkipNeReg, // 9XY0
+    LoadI, // ANNN
+    JumpOffset, // BNNN
+    Random, // CXNN
+    DrawBig, // DXY0
+    Draw, // DXYN
+    SkipKey, // EX9E
+    SkipNotKey, // EXA1
+    LongI, // F000 NNNN
+    Plane, // FN01
+    Audio, // F002
+    GetDelay, // FX07
+    WaitKey, // FX0A
+    SetDelay, // FX15
+    SetSound, // FX18
+    AddI, // FX1E
+    Font, // FX29
+    BigFont, // FX30
+    Bcd, // FX33
+    Pitch, // FX3A
+    Store, // FX55
+    Load, // FX65
+    SaveFlags, // FX75
+    LoadFlags, // FX85
+    Count
+};
+
+// Platforms an instruction exists on, one bit per Mode
+enum Platform : uint8_t {
+    P_CHIP8 = 1 << 0,
+    P_SCHIP10 = 1 << 1,
+    P_SCHIP11 = 1 << 2,
+    P_SUPERCHIP = 1 << 3,
+    P_XOCHIP = 1 << 4,
+    P_SCHIP = P_SCHIP10 | P_SCHIP11 | P_SUPERCHIP | P_XOCHIP, // SUPER-CHIP and its descendants
+    P_ALL = P_CHIP8 | P_SCHIP
+};
+
+enum OpFlag : uint16_t {
+    F_NONE = 0,
+    F_BRANCH = 1 << 0, // Transfers control somewhere other than the next instruction
+    F_INDIRECT = 1 << 1, // Branch target depends on register state
+    F_CALL = 1 << 2, // Pushes a return address
+    F_RETURN = 1 << 3, // Pops a return address
+    F_SKIP = 1 << 4, // May skip the next instruction
+    F_HALT = 1 << 5, // Stops the machine
+    F_READS_MEMORY = 1 << 6, // Reads memory at I
+    F_WRITES_MEMORY = 1 << 7, // Writes memory at I
+    F_DRAWS = 1 << 8, // Modifies the framebuffer
+    F_READS_KEYS = 1 << 9, // Depends on keypad state
+    F_TIMERS = 1 << 10, // Reads or writes the delay/sound timers
+    F_SETS_VF = 1 << 11, // Writes VF as a flag
+    F_WRITES_I = 1 << 12 // Modifies the index register
+};
+
+struct OpInfo {
+    Op op;
+    uint8_t platforms; // Platform bits
+    uint8_t length; // Size in bytes
+    uint16_t flags; // OpFlag bits
+    const char *format; // Mnemonic; {X}/{Y} hex register, {x}/{y}/{n} decimal, {NN}/{NNN} hex immediate
+};
+
+constexpr uint16_t F_ALU = F_SETS_VF;
+constexpr uint16_t F_LOAD = F_READS_MEMORY | F_WRITES_I;
+constexpr uint16_t F_STORE = F_WRITES_MEMORY | F_WRITES_I;
+
+// Indexed by Op
+inline constexpr OpInfo OP_INFO[] = {
+    {Op::Invalid, P_ALL, 2, F_NONE, ""},
+    {Op::Sys, P_ALL, 2, F_NONE, "sys 0x{NNN}"},
+    {Op::Cls, P_ALL, 2, F_DRAWS, "clear"},
+    {Op::Ret, P_ALL, 2, F_BRANCH | F_INDIRECT | F_RETURN, "return"},
+    {Op::ScrollDown, P_SCHIP, 2, F_DRAWS, "scroll-down {n}"},
+    {Op::ScrollUp, P_XOCHIP, 2, F_DRAWS, "scroll-up {n}"},
+    {Op::ScrollRight, P_SCHIP, 2, F_DRAWS, "scroll-right"},
+    {Op::ScrollLeft, P_SCHIP, 2, F_DRAWS, "scroll-left"},
+    {Op::Exit, P_SCHIP, 2, F_HALT, "exit"},
+    {Op::LoRes, P_SCHIP, 2, F_DRAWS, "lores"},
+    {Op::HiRes, P_SCHIP, 2, F_DRAWS, "hires"},
+    {Op::Jump, P_ALL, 2, F_BRANCH, "jump 0x{NNN}"},
+    {Op::Call, P_ALL, 2, F_BRANCH | F_CALL, "call 0x{NNN}"},
+    {Op::SkipEqImm, P_ALL, 2, F_SKIP, "skip if V(0x{X}) == 0x{NN}"},
+    {Op::SkipNeImm, P_ALL, 2, F_SKIP, "skip if V(0x{X}) != 0x{NN}"},
+    {Op::SkipEqReg, P_ALL, 2, F_SKIP, "skip if V(0x{X}) == V(0x{Y})"},
+    {Op::SaveRange, P_XOCHIP, 2, F_WRITES_MEMORY, "save V(0x{X}) - V(0x{Y})"},
+    {Op::LoadRange, P_XOCHIP, 2, F_READS_MEMORY, "load V(0x{X}) - V(0x{Y})"},
+    {Op::LoadImm, P_ALL, 2, F_NONE, "V(0x{X}) := 0x{NN}"},
+    {Op::AddImm, P_ALL, 2, F_NONE, "V(0x{X}) += 0x{NN}"},
+    {Op::Move, P_ALL, 2, F_NONE, "V(0x{X}) := V(0x{Y})"},
+    {Op::Or, P_ALL, 2, F_ALU, "V(0x{X}) := V(0x{X}) OR V(0x{Y})"},
+    {Op::And, P_ALL, 2, F_ALU, "V(0x{X}) := V(0x{X}) AND V(0x{Y})"},
+    {Op::Xor, P_ALL, 2, F_ALU, "V(0x{X}) := V(0x{X}) XOR V(0x{Y})"},
+    {Op::Add, P_ALL, 2, F_ALU, "V(0x{X}) := V(0x{X}) + V(0x{Y})"},
+    {Op::Sub, P_ALL, 2, F_ALU, "V(0x{X}) := V(0x{X}) - V(0x{Y})"},
+    {Op::Shr, P_ALL, 2, F_ALU, "V(0x{X}) := V(0x{X}) >> 1"},
+    {Op::SubN, P_ALL, 2, F_ALU, "V(0x{X}) := V(0x{Y}) - V(0x{X})"},
+    {Op::Shl, P_ALL, 2, F_ALU, "V(0x{X}) := V(0x{X}) << 1"},
+    {Op::SkipNeReg, P_ALL, 2, F_SKIP, "skip if V(0x{X}) != V(0x{Y})"},
+    {Op::LoadI, P_ALL, 2, F_WRITES_I, "I := 0x{NNN}"},
+    {Op::JumpOffset, P_ALL, 2, F_BRANCH | F_INDIRECT, "jump V0 + 0x{NNN}"},
+    {Op::Random, P_ALL, 2, F_NONE, "rand, bitmask V(0x{X})"},
+    {Op::DrawBig, P_SCHIP, 2, F_READS_MEMORY | F_DRAWS | F_SETS_VF, "draw ({x}, {y}), height {n}"},
+    {Op::Draw, P_ALL, 2, F_READS_MEMORY | F_DRAWS | F_SETS_VF, "draw ({x}, {y}), height {n}"},
+    {Op::SkipKey, P_ALL, 2, F_SKIP | F_READS_KEYS, "skip if key V(0x{X}) pressed"},
+    {Op::SkipNotKey, P_ALL, 2, F_SKIP | F_READS_KEYS, "skip if key V(0x{X}) not pressed"},
+    {Op::LongI, P_XOCHIP, 4, F_WRITES_I, "I := long"},
+    {Op::Plane, P_XOCHIP, 2, F_NONE, "plane {x}"},
+    {Op::Audio, P_XOCHIP, 2, F_READS_MEMORY, "audio"},
+    {Op::GetDelay, P_ALL, 2, F_TIMERS, "delay store V(0x{X})"},
+    {Op::WaitKey, P_ALL, 2, F_READS_KEYS, "wait for key V(0x{X})"},
+    {Op::SetDelay, P_ALL, 2, F_TIMERS, "delay set V(0x{X})"},
+    {Op::SetSound, P_ALL, 2, F_TIMERS, "sound set V(0x{X})"},
+    {Op::AddI, P_ALL, 2, F_WRITES_I, "I += V(0x{X})"},
+    {Op::Font, P_ALL, 2, F_WRITES_I, "I := addr sprite V(0x{X})"},
+    {Op::BigFont, P_SCHIP, 2, F_WRITES_I, "I := addr bigsprite V(0x{X})"},
+    {Op::Bcd, P_ALL, 2, F_WRITES_MEMORY, "BCD store V(0x{X})"},
+    {Op::Pitch, P_XOCHIP, 2, F_NONE, "pitch := V(0x{X})"},
+    {Op::Store, P_ALL, 2, F_STORE, "store V0 to V(0x{X})"},
+    {Op::Load, P_ALL, 2, F_LOAD, "load V0 to V(0x{X})"},
+    {Op::SaveFlags, P_SCHIP, 2, F_NONE, "saveflags V0 to V(0x{X})"},
+    {Op::LoadFlags, P_SCHIP, 2, F_NONE, "loadflags V0 to V(0x{X})"},
+};
+
+constexpr bool opInfoIndexed() {
+    for (int i = 0; i < static_cast<int>(Op::Count); i++) {
+        if (static_cast<int>(OP_INFO[i].op) != i) {
+            return false;
+        }
+    }
+    return std::size(OP_INFO) == static_cast<size_t>(Op::Count);
+}
+
+static_assert(opInfoIndexed(), "OP_INFO must list every Op in enum order");
+
+struct OpPattern {
+    uint16_t mask;
+    uint16_t match;
+    Op op;
+};
+
+// First match wins, so specific encodings come before the general ones they overlap
+inline constexpr OpPattern OP_PATTERNS[] = {
+    {0xFFFF, 0x00E0, Op::Cls},
+    {0xFFFF, 0x00EE, Op::Ret},
+    {0xFFF0, 0x00C0, Op::ScrollDown},
+    {0xFFF0, 0x00D0, Op::ScrollUp},
+    {0xFFFF, 0x00FB, Op::ScrollRight},
+    {0xFFFF, 0x00FC, Op::ScrollLeft},
+    {0xFFFF, 0x00FD, Op::Exit},
+    {0xFFFF, 0x00FE, Op::LoRes},
+    {0xFFFF, 0x00FF, Op::HiRes},
+    {0xF000, 0x0000, Op::Sys},
+    {0xF000, 0x1000, Op::Jump},
+    {0xF000, 0x2000, Op::Call},
+    {0xF000, 0x3000, Op::SkipEqImm},
+    {0xF000, 0x4000, Op::SkipNeImm},
+    {0xF00F, 0x5000, Op::SkipEqReg},
+    {0xF00F, 0x5002, Op::SaveRange},
+    {0xF00F, 0x5003, Op::LoadRange},
+    {0xF000, 0x6000, Op::LoadImm},
+    {0xF000, 0x7000, Op::AddImm},
+    {0xF00F, 0x8000, Op::Move},
+    {0xF00F, 0x8001, Op::Or},
+    {0xF00F, 0x8002, Op::And},
+    {0xF00F, 0x8003, Op::Xor},
+    {0xF00F, 0x8004, Op::Add},
+    {0xF00F, 0x8005, Op::Sub},
+    {0xF00F, 0x8006, Op::Shr},
+    {0xF00F, 0x8007, Op::SubN},
+    {0xF00F, 0x800E, Op::Shl},
+    {0xF00F, 0x9000, Op::SkipNeReg},
+    {0xF000, 0xA000, Op::LoadI},
+    {0xF000, 0xB000, Op::JumpOffset},
+    {0xF000, 0xC000, Op::Random},
+    {0xF00F, 0xD000, Op::DrawBig},
+    {0xF000, 0xD000, Op::Draw},
+    {0xF0FF, 0xE09E, Op::SkipKey},
+    {0xF0FF, 0xE0A1, Op::SkipNotKey},
+    {0xFFFF, 0xF000, Op::LongI},
+    {0xF0FF, 0xF001, Op::Plane},
+    {0xFFFF, 0xF002, Op::Audio},
+    {0xF0FF, 0xF007, Op::GetDelay},
+    {0xF0FF, 0xF00A, Op::WaitKey},
+    {0xF0FF, 0xF015, Op::SetDelay},
+    {0xF0FF, 0xF018, Op::SetSound},
+    {0xF0FF, 0xF01E, Op::AddI},
+    {0xF0FF, 0xF029, Op::Font},
+    {0xF0FF, 0xF030, Op::BigFont},
+    {0xF0FF, 0xF033, Op::Bcd},
+    {0xF0FF, 0xF03A, Op::Pitch},
+    {0xF0FF, 0xF055, Op::Store},
+    {0xF0FF, 0xF065, Op::Load},
+    {0xF0FF, 0xF075, Op::SaveFlags},
+    {0xF0FF, 0xF085, Op::LoadFlags},
+};
+
+constexpr std::array<Op, 0x10000> buildDecodeTable() {
+    std::array<Op, 0x10000> table{}; // Op::Invalid
+    // Walk the patterns backwards so earlier (more specific) ones overwrite later ones,
+    // visiting only the words each pattern matches
+    for (size_t p = std::size(OP_PATTERNS); p-- > 0;) {
+        const OpPattern &pattern = OP_PATTERNS[p];
+        uint16_t free = static_cast<uint16_t>(~pattern.mask);
+        uint16_t bits = 0;
+        do {
+            table[pattern.match | bits] = pattern.op;
+            bits = static_cast<uint16_t>((bits - free) & free); // Next subset of the free bits
+        } while (bits != 0);
+    }
+    return table;
+}
+
+// Instruction word -> Op, generated at compile time
+inline constexpr std::array<Op, 0x10000> DECODE_TABLE = buildDecodeTable();
+
+constexpr const OpInfo &opInfo(Op op) { return OP_INFO[static_cast<uint8_t>(op)]; }
+constexpr const OpInfo &opInfo(uint16_t word) { return opInfo(DECODE_TABLE[word]); }
+
+static_assert(DECODE_TABLE[0x00E0] == Op::Cls && DECODE_TABLE[0x0123] == Op::Sys);
+static_assert(DECODE_TABLE[0xD120] == Op::DrawBig && DECODE_TABLE[0xD12F] == Op::Draw);
+static_assert(DECODE_TABLE[0x5122] == Op::SaveRange && DECODE_TABLE[0x5121] == Op::Invalid);
+
+#endif //OPCODES_H
@@ -0,0 +1,159 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "Profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr size_t MAX_CALL_DEPTH = 16; // Matches the machine stack
+constexpr size_t MAX_ACTIVE_LOOPS = 64; // Deeper nesting forgets the outermost loop
+
+std::string hex(uint32_t value, int width = 3) {
+    std::stringstream ss;
+    ss << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(width) << value;
+    return ss.str();
+}
+
+std::string percent(uint64_t part, uint64_t total) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1) << (total ? 100.0 * part / total : 0.0) << "%";
+    return ss.str();
+}
+
+}
+
+Profiler::Profiler() : counts(0x10000, 0) {
+}
+
+void Profiler::record(const Chip8 &machine, uint16_t pc, Instruction i) {
+    uint64_t count = ++counts[pc];
+    maxCount = std::max(maxCount, count);
+    cycles++;
+
+    // Close the loops execution has left: outside their range, and not in a callee
+    while (!activeLoops.empty()) {
+        const ActiveLoop &loop = activeLoops.back();
+        bool inside = callStack.size() > loop.depth ||
+                      (callStack.size() == loop.depth && pc >= loop.start && pc <= loop.end);
+        if (inside) {
+            break;
+        }
+        loops[{loop.start, loop.end}].cycles += cycles - 1 - loop.entryCycle;
+        activeLoops.pop_back();
+    }
+
+    switch (machine.decodeOp(i)) {
+        case Op::Call:
+            if (callStack.size() == MAX_CALL_DEPTH) {
+                callStack.erase(callStack.begin()); // Runaway recursion, forget the oldest frame
+            }
+            callStack.push_back({i.nnn, cycles});
+            subroutines.try_emplace(i.nnn, SubroutineProfile{i.nnn}).first->second.calls++;
+            break;
+        case Op::Ret:
+            if (!callStack.empty()) {
+                const Frame &frame = callStack.back();
+                subroutines[frame.address].inclusiveCycles += cycles - frame.entryCycle;
+                callStack.pop_back();
+            }
+            break;
+        case Op::Jump:
+            if (i.nnn <= pc) {
+                loops.try_emplace({i.nnn, pc}, LoopProfile{i.nnn, pc}).first->second.iterations++;
+                if (activeLoops.empty() || activeLoops.back().start != i.nnn || activeLoops.back().end != pc) {
+                    if (activeLoops.size() == MAX_ACTIVE_LOOPS) {
+                        activeLoops.erase(activeLoops.begin());
+                    }
+                    activeLoops.push_back({i.nnn, pc, callStack.size(), cycles - 1});
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Profiler::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    maxCount = 0;
+    cycles = 0;
+    subroutines.clear();
+    loops.clear();
+    callStack.clear();
+    activeLoops.clear();
+}
+
+std::vector<SubroutineProfile> Profiler::getSubroutines() const {
+    std::map<uint16_t, SubroutineProfile> current = subroutines;
+    for (const Frame &frame : callStack) {
+        current[frame.address].inclusiveCycles += cycles - frame.entryCycle;
+    }
+
+    std::vector<SubroutineProfile> sorted;
+    for (const auto &[address, profile] : current) {
+        sorted.push_back(profile);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const SubroutineProfile &a, const SubroutineProfile &b) {
+        return a.inclusiveCycles > b.inclusiveCycles;
+    });
+    return sorted;
+}
+
+std::vector<LoopProfile> Profiler::getLoops() const {
+    std::map<std::pair<uint16_t, uint16_t>, LoopProfile> current = loops;
+    for (const ActiveLoop &loop : activeLoops) {
+        current[{loop.start, loop.end}].cycles += cycles - loop.entryCycle;
+    }
+
+    std::vector<LoopProfile> sorted;
+    for (const auto &[edge, profile] : current) {
+        sorted.push_back(profile);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const LoopProfile &a, const LoopProfile &b) {
+        return a.cycles > b.cycles;
+    });
+    return sorted;
+}
+
+std::string Profiler::report(const Chip8 &machine, size_t limit) const {
+    std::stringstream out;
+    out << "Profile: " << cycles << " cycles\n";
+
+    std::vector<uint16_t> addresses;
+    for (uint32_t address = 0; address < machine.memorySize(); address++) {
+        if (counts[address]) {
+            addresses.push_back(static_cast<uint16_t>(address));
+        }
+    }
+    std::stable_sort(addresses.begin(), addresses.end(), [this](uint16_t a, uint16_t b) {
+        return counts[a] > counts[b];
+    });
+
+    out << "\nHot addresses:\n";
+    for (size_t n = 0; n < addresses.size() && n < limit; n++) {
+        uint16_t address = addresses[n];
+        out << "  " << hex(address, 4) << std::setw(12) << counts[address] << std::setw(8)
+            << percent(counts[address], cycles) << "  " << machine.disassemble(machine.decode(machine.peek(address))) << "\n";
+    }
+
+    std::vector<SubroutineProfile> calls = getSubroutines();
+    out << "\nSubroutines (inclusive):\n";
+    for (size_t n = 0; n < calls.size() && n < limit; n++) {
+        const SubroutineProfile &s = calls[n];
+        out << "  " << hex(s.address, 4) << std::setw(12) << s.inclusiveCycles << std::setw(8)
+            << percent(s.inclusiveCycles, cycles) << "  " << s.calls << " calls\n";
+    }
+
+    std::vector<LoopProfile> loops = getLoops();
+    out << "\nLoops (inclusive, from the first backward jump):\n";
+    for (size_t n = 0; n < loops.size() && n < limit; n++) {
+        const LoopProfile &l = loops[n];
+        out << "  " << hex(l.start, 4) << "-" << hex(l.end, 4) << std::setw(12) << l.cycles << std::setw(8)
+            << percent(l.cycles, cycles) << "  " << l.iterations << " iterations\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,72 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Chip8.h"
+
+struct SubroutineProfile {
+    uint16_t address; // 2NNN target
+    uint64_t calls = 0;
+    uint64_t inclusiveCycles = 0; // Instructions executed between the call and its 00EE
+};
+
+struct LoopProfile {
+    uint16_t start; // Backward jump target
+    uint16_t end; // Address of the jump
+    uint64_t iterations = 0; // Times the backward jump was taken
+    uint64_t cycles = 0; // Instructions executed while the loop ran, callees included
+};
+
+/*
+ * Execution profiler.
+ * Frontends call record() for every executed instruction; it bumps a counter for the
+ * instruction's address and pairs 2NNN with 00EE on a shadow call stack to attribute
+ * inclusive cycles to subroutines. A loop runs from its first taken backward jump until
+ * execution leaves [start, end] at the same call depth; the instructions in between,
+ * callees included, are its cycles. One instruction counts as one cycle.
+ */
+class Profiler {
+    struct Frame {
+        uint16_t address;
+        uint64_t entryCycle;
+    };
+    struct ActiveLoop {
+        uint16_t start;
+        uint16_t end;
+        size_t depth; // Call stack size at the backward jump
+        uint64_t entryCycle; // Cycle count before the first backward jump
+    };
+
+    std::vector<uint64_t> counts; // Executions per address
+    uint64_t maxCount = 0;
+    uint64_t cycles = 0;
+    std::map<uint16_t, SubroutineProfile> subroutines;
+    std::map<std::pair<uint16_t, uint16_t>, LoopProfile> loops; // Keyed by (target, jump address)
+    std::vector<Frame> callStack;
+    std::vector<ActiveLoop> activeLoops; // Innermost last
+
+public:
+    Profiler();
+
+    void record(const Chip8 &machine, uint16_t pc, Instruction i); // After the instruction at pc executed
+    void reset();
+
+    uint64_t getCount(uint16_t address) const { return counts[address]; }
+    uint64_t getMaxCount() const { return maxCount; }
+    uint64_t getCycles() const { return cycles; }
+
+    std::vector<SubroutineProfile> getSubroutines() const; // Sorted by inclusive cycles, open calls included
+    std::vector<LoopProfile> getLoops() const; // Sorted by cycles, running loops included
+    std::string report(const Chip8 &machine, size_t limit = 20) const; // Hot addresses, subroutines and loops
+};
+
+#endif //PROFILER_H
@@ -0,0 +1,88 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "RomLoader.h"
+#include "XOChip.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+std::optional<Mode> parseMode(std::string_view name) {
+    if (name == "auto") {
+        return std::nullopt;
+    }
+    for (Mode mode : {Mode::CHIP8, Mode::SCHIP10, Mode::SCHIP11, Mode::SUPERCHIP, Mode::XOCHIP}) {
+        if (name == modeName(mode)) {
+            return mode;
+        }
+    }
+    throw std::runtime_error("Invalid chip type. Use 'auto', 'chip8', 'schip10', 'schip11', 'superchip' or 'xochip'");
+}
+
+std::vector<uint8_t> readROMFile(const std::string &path) {
+    std::ifstream rom(path, std::ios::binary | std::ios::ate);
+    if (!rom.is_open()) {
+        throw std::runtime_error("Unable to open ROM file: " + path);
+    }
+
+    std::streamsize size = rom.tellg();
+    rom.seekg(0, std::ios::beg);
+
+    std::vector<uint8_t> data(size);
+    rom.read(reinterpret_cast<char *>(data.data()), size);
+    return data;
+}
+
+// Scans every aligned word as if it were code, so data that happens to look like an
+// extension opcode can promote a CHIP-8 ROM, and opcodes at odd addresses are missed.
+// SCHIP10 and SCHIP11 are never returned: they use the same opcodes as modern
+// SUPER-CHIP and differ only in quirks, which opcodes cannot reveal. ROMs written for
+// the original HP-48 interpreters need --chip schip10 or schip11.
+Mode detectMode(const uint8_t *data, size_t size) {
+    // Anything that does not fit the 4K address space can only be XO-CHIP
+    if (size > 3584) {
+        return Mode::XOCHIP;
+    }
+
+    bool superChip = false;
+    for (size_t pc = 0; pc + 1 < size; pc += 2) {
+        uint16_t op = (data[pc] << 8) | data[pc + 1];
+        uint8_t nn = op & 0xFF;
+
+        // XO-CHIP only: long I, audio, plane select, register ranges, scroll up
+        if (op == 0xF000 || op == 0xF002 || (op & 0xF0FF) == 0xF001 ||
+            (op & 0xF00E) == 0x5002 || (op & 0xFFF0) == 0x00D0) {
+            return Mode::XOCHIP;
+        }
+        // SUPER-CHIP: scrolling, resolution switch, big font, RPL flags
+        if (op == 0x00FB || op == 0x00FC || op == 0x00FE || op == 0x00FF ||
+            (op & 0xFFF0) == 0x00C0 ||
+            ((op & 0xF000) == 0xF000 && (nn == 0x30 || nn == 0x75 || nn == 0x85))) {
+            superChip = true;
+        }
+    }
+    return superChip ? Mode::SUPERCHIP : Mode::CHIP8;
+}
+
+std::unique_ptr<Chip8> createMachine(Mode mode) {
+    std::unique_ptr<Chip8> machine;
+    if (mode == Mode::CHIP8) {
+        machine = std::make_unique<Machine<Chip8>>();
+    } else if (mode == Mode::XOCHIP) {
+        machine = std::make_unique<Machine<XOChip>>();
+    } else {
+        machine = std::make_unique<Machine<SuperChip>>();
+    }
+    machine->setMode(mode);
+    return machine;
+}
+
+std::unique_ptr<Chip8> createMachineForROM(const std::string &path, std::optional<Mode> forced) {
+    std::vector<uint8_t> rom = readROMFile(path);
+
+    Mode mode = forced ? *forced : detectMode(rom.data(), rom.size());
+    std::unique_ptr<Chip8> machine = createMachine(mode);
+    machine->loadROM(rom.data(), rom.size());
+    return machine;
+}
@@ -0,0 +1,34 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef ROMLOADER_H
+#define ROMLOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Chip8.h"
+
+// FNV-1a 64-bit hash of a ROM image, usable at compile time (netplay peers compare it)
+constexpr uint64_t hashROM(const uint8_t *data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+std::optional<Mode> parseMode(std::string_view name); // Command line chip type, "auto" gives nullopt
+std::vector<uint8_t> readROMFile(const std::string &path); // Read a whole ROM file
+Mode detectMode(const uint8_t *data, size_t size); // Heuristic: guess platform from the opcodes a ROM uses
+std::unique_ptr<Chip8> createMachine(Mode mode); // Create the core specialized for a platform
+// Load a ROM into the core detectMode() picks for it; forced overrides detection
+std::unique_ptr<Chip8> createMachineForROM(const std::string &path, std::optional<Mode> forced = std::nullopt);
+
+#endif //ROMLOADER_H
@@ -0,0 +1,86 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "RomWatcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "RomLoader.h"
+
+RomWatcher::RomWatcher(const std::string &path) : path(path), rom(readROMFile(path)) {
+    std::filesystem::path file(path);
+    fileName = file.filename().string();
+    std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Unable to watch ROM file: ") + std::strerror(errno));
+    }
+    if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error("Unable to watch " + directory + ": " + std::strerror(error));
+    }
+}
+
+RomWatcher::~RomWatcher() {
+    close(fd);
+}
+
+bool RomWatcher::changed() {
+    bool rewritten = false;
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char *at = buffer; at < buffer + length;) {
+            auto *event = reinterpret_cast<inotify_event *>(at);
+            if (event->len && fileName == event->name) {
+                rewritten = true;
+            }
+            at += sizeof(inotify_event) + event->len;
+        }
+    }
+    return rewritten;
+}
+
+RomReload RomWatcher::patch(Chip8 &machine, const std::vector<uint8_t> &updated) const {
+    RomReload result;
+    bool inRange = false;
+    size_t end = std::max(rom.size(), updated.size());
+    for (size_t i = 0; i < end; i++) {
+        // Bytes past the end of a shrunk ROM go back to what a fresh load leaves there
+        uint8_t before = i < rom.size() ? rom[i] : 0;
+        uint8_t after = i < updated.size() ? updated[i] : 0;
+        bool differs = before != after;
+        if (differs) {
+            machine.writeMemory(static_cast<uint16_t>(0x200 + i), after);
+            result.bytes++;
+            result.ranges += !inRange;
+        }
+        inRange = differs;
+    }
+    return result;
+}
+
+RomReload RomWatcher::reload(Chip8 &machine) {
+    std::vector<uint8_t> updated = readROMFile(path);
+    if (updated.size() > machine.memorySize() - 0x200) {
+        throw std::runtime_error("ROM size exceeds memory capacity");
+    }
+
+    RomReload result;
+    if (checkpoint) {
+        result = patch(*checkpoint, updated);
+        machine.restore(*checkpoint);
+        result.restored = true;
+    } else {
+        result = patch(machine, updated);
+    }
+    rom = std::move(updated);
+    return result;
+}
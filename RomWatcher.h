@@ -0,0 +1,56 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef ROMWATCHER_H
+#define ROMWATCHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Chip8.h"
+
+// Outcome of applying a rewritten ROM file
+struct RomReload {
+    size_t bytes = 0; // Bytes that differed from the previous version
+    size_t ranges = 0; // Runs of consecutive changed bytes
+    bool restored = false; // The machine went back to the checkpoint
+};
+
+/*
+ * Hot reload for ROM development (Linux inotify).
+ * The ROM's directory is watched rather than the file, so editors and assemblers that
+ * save through a temporary file and a rename are seen as well as in-place rewrites.
+ * A reload writes only the bytes that differ from the previous version, through
+ * writeMemory(), so the memory hash follows the edit and FrameCache entries of the old
+ * code stop matching; the core keeps no other decoded form of memory.
+ * With a checkpoint set, the new bytes go into the checkpoint and the machine returns to
+ * it: the program resumes from the state being tested, running the new code. Bytes the
+ * program itself wrote are kept wherever the edit didn't touch the ROM.
+ */
+class RomWatcher {
+    std::string path;
+    std::string fileName; // Inotify reports names relative to the directory
+    int fd = -1;
+    std::vector<uint8_t> rom; // Version currently in the machine
+    std::unique_ptr<Chip8> checkpoint;
+
+    RomReload patch(Chip8 &machine, const std::vector<uint8_t> &updated) const;
+
+public:
+    explicit RomWatcher(const std::string &path);
+    ~RomWatcher();
+
+    RomWatcher(const RomWatcher&) = delete;
+    RomWatcher& operator=(const RomWatcher&) = delete;
+
+    bool changed(); // Drain pending events without blocking; true if the ROM file was rewritten
+    RomReload reload(Chip8 &machine); // Apply the file as it is now
+
+    void setCheckpoint(const Chip8 &machine) { checkpoint = machine.clone(); }
+    bool hasCheckpoint() const { return checkpoint != nullptr; }
+};
+
+#endif //ROMWATCHER_H
@@ -0,0 +1,275 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "Scaler.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t LEFTMOST = 1ULL << 63;
+
+// One word of both bit planes: 64 pixels with 2-bit colors
+struct Pixels {
+    uint64_t p0;
+    uint64_t p1;
+};
+
+// Bit set where the colors match
+uint64_t same(Pixels a, Pixels b) {
+    return ~((a.p0 ^ b.p0) | (a.p1 ^ b.p1));
+}
+
+// a where mask is set, b elsewhere
+Pixels pick(uint64_t mask, Pixels a, Pixels b) {
+    return {(a.p0 & mask) | (b.p0 & ~mask), (a.p1 & mask) | (b.p1 & ~mask)};
+}
+
+// Word j of a row shifted so every pixel sees its left/right neighbour; edge pixels see themselves
+uint64_t leftOf(const uint64_t *row, int j) {
+    return (row[j] >> 1) | (j ? row[j - 1] << 63 : row[0] & LEFTMOST);
+}
+
+uint64_t rightOf(const uint64_t *row, int j, int words) {
+    return (row[j] << 1) | (j + 1 < words ? row[j + 1] >> 63 : row[j] & 1);
+}
+
+// 3x3 neighbourhood of 64 pixels:  a b c / d e f / g h i
+struct Neighbourhood {
+    Pixels a, b, c, d, e, f, g, h, i;
+};
+
+Neighbourhood gather(const Display &display, int y, int j) {
+    int up = std::max(y - 1, 0);
+    int down = std::min(y + 1, display.getHeight() - 1);
+    int words = display.getWidth() / 64;
+    auto row = [&](int plane, int r) { return display.planes[plane][r]; };
+    auto at = [&](int r) { return Pixels{row(0, r)[j], row(1, r)[j]}; };
+    auto left = [&](int r) { return Pixels{leftOf(row(0, r), j), leftOf(row(1, r), j)}; };
+    auto right = [&](int r) { return Pixels{rightOf(row(0, r), j, words), rightOf(row(1, r), j, words)}; };
+    return {left(up), at(up), right(up), left(y), at(y), right(y), left(down), at(down), right(down)};
+}
+
+// Bit b of a byte moved to bit k * b, for spreading one filtered sub-pixel across k output pixels
+struct SpreadTable {
+    uint32_t bits[4][256]{};
+
+    constexpr SpreadTable() {
+        for (int k = 1; k <= 3; k++) {
+            for (int value = 0; value < 256; value++) {
+                for (int b = 0; b < 8; b++) {
+                    if (value & (1 << b)) {
+                        bits[k][value] |= 1u << (k * b);
+                    }
+                }
+            }
+        }
+    }
+};
+
+constexpr SpreadTable SPREAD;
+
+// Bits of a byte as 8 bytes of 0 or 1, leftmost pixel first in memory
+struct ByteTable {
+    uint8_t bytes[256][8]{};
+
+    constexpr ByteTable() {
+        for (int value = 0; value < 256; value++) {
+            for (int b = 0; b < 8; b++) {
+                bytes[value][b] = (value >> (7 - b)) & 1;
+            }
+        }
+    }
+};
+
+constexpr ByteTable BYTES;
+
+// Sub-pixels of 64 display pixels, row-major k x k
+void filterWord(ScaleFilter filter, const Neighbourhood &n, Pixels *out) {
+    const Pixels &b = n.b, &d = n.d, &e = n.e, &f = n.f, &h = n.h;
+    switch (filter) {
+        case ScaleFilter::Nearest:
+            out[0] = e;
+            break;
+        case ScaleFilter::Scale2x: {
+            uint64_t db = same(d, b), bf = same(b, f), dh = same(d, h), hf = same(h, f);
+            out[0] = pick(db & ~bf & ~dh, d, e);
+            out[1] = pick(bf & ~db & ~hf, f, e);
+            out[2] = pick(dh & ~db & ~hf, d, e);
+            out[3] = pick(hf & ~bf & ~dh, f, e);
+            break;
+        }
+        case ScaleFilter::Scale3x: {
+            uint64_t db = same(d, b), bf = same(b, f), dh = same(d, h), hf = same(h, f);
+            uint64_t ea = same(e, n.a), ec = same(e, n.c), eg = same(e, n.g), ei = same(e, n.i);
+            uint64_t topLeft = db & ~bf & ~dh; // Corner conditions
+            uint64_t topRight = bf & ~db & ~hf;
+            uint64_t bottomLeft = dh & ~db & ~hf;
+            uint64_t bottomRight = hf & ~dh & ~bf;
+            out[0] = pick(topLeft, d, e);
+            out[1] = pick((topLeft & ~ec) | (topRight & ~ea), b, e);
+            out[2] = pick(topRight, f, e);
+            out[3] = pick((topLeft & ~eg) | (bottomLeft & ~ea), d, e);
+            out[4] = e;
+            out[5] = pick((topRight & ~ei) | (bottomRight & ~ec), f, e);
+            out[6] = pick(bottomLeft, d, e);
+            out[7] = pick((bottomLeft & ~ei) | (bottomRight & ~eg), h, e);
+            out[8] = pick(bottomRight, f, e);
+            break;
+        }
+    }
+}
+
+}
+
+std::optional<ScaleFilter> parseScaleFilter(std::string_view name) {
+    if (name == "nearest") return ScaleFilter::Nearest;
+    if (name == "epx" || name == "scale2x") return ScaleFilter::Scale2x;
+    if (name == "scale3x") return ScaleFilter::Scale3x;
+    return std::nullopt;
+}
+
+Scaler::Scaler(ScaleFilter filter, int scale)
+    : filter(filter), scale(scale),
+      factor(filter == ScaleFilter::Scale3x ? 3 : filter == ScaleFilter::Scale2x ? 2 : 1),
+      palette{0xFF000000, 0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555} {
+}
+
+void Scaler::resize(const Display &display) {
+    width = display.getWidth() * factor;
+    height = display.getHeight() * factor;
+    for (std::vector<uint8_t> &plane : smoothed) {
+        plane.assign(static_cast<size_t>(width / 8) * height, 0);
+    }
+    colors.assign(static_cast<size_t>(width) * height, 0);
+    glow.assign(colors.size(), palette[0]);
+    fading.assign(height, 0);
+
+    // First output column/row whose nearest filtered pixel is x
+    int outWidth = outputWidth(display);
+    int outHeight = outputHeight(display);
+    columnStarts.resize(width + 1);
+    for (int x = 0; x <= width; x++) {
+        columnStarts[x] = (x * outWidth + width - 1) / width;
+    }
+    rowStarts.resize(height + 1);
+    for (int y = 0; y <= height; y++) {
+        rowStarts[y] = (y * outHeight + height - 1) / height;
+    }
+    invalid = true;
+}
+
+void Scaler::smoothRow(const Display &display, int y) {
+    int words = display.getWidth() / 64;
+    int rowBytes = width / 8;
+    Pixels sub[9];
+    for (int j = 0; j < words; j++) {
+        filterWord(filter, gather(display, y, j), sub);
+        // Interleave the k sub-pixel columns of each output row, one source byte at a time
+        for (int r = 0; r < factor; r++) {
+            const Pixels *cells = sub + r * factor;
+            size_t offset = static_cast<size_t>(y * factor + r) * rowBytes + j * 8 * factor;
+            for (int plane = 0; plane < Display::PLANES; plane++) {
+                uint8_t *out = smoothed[plane].data() + offset;
+                for (int byte = 0; byte < 8; byte++) {
+                    int shift = 56 - 8 * byte;
+                    uint32_t spread = 0;
+                    for (int c = 0; c < factor; c++) {
+                        uint64_t word = plane ? cells[c].p1 : cells[c].p0;
+                        spread |= SPREAD.bits[factor][(word >> shift) & 0xFF] << (factor - 1 - c);
+                    }
+                    for (int k = factor - 1; k >= 0; k--) {
+                        *out++ = static_cast<uint8_t>(spread >> (8 * k));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Scaler::colorizeRow(int row) {
+    // Unpack 8 pixels per table lookup, then map the plane bits through the palette
+    int rowBytes = width / 8;
+    const uint8_t *plane0 = smoothed[0].data() + static_cast<size_t>(row) * rowBytes;
+    const uint8_t *plane1 = smoothed[1].data() + static_cast<size_t>(row) * rowBytes;
+    uint32_t *out = colors.data() + static_cast<size_t>(row) * width;
+    for (int n = 0; n < rowBytes; n++, out += 8) {
+        const uint8_t *low = BYTES.bytes[plane0[n]];
+        const uint8_t *high = BYTES.bytes[plane1[n]];
+        for (int b = 0; b < 8; b++) {
+            out[b] = palette[low[b] | high[b] << 1];
+        }
+    }
+}
+
+bool Scaler::blendRow(int row) {
+    // Per channel max(current, previous * persistence): lit pixels show at once and fade out
+    size_t offset = static_cast<size_t>(row) * width;
+    uint8_t *previous = reinterpret_cast<uint8_t *>(glow.data() + offset);
+    const uint8_t *current = reinterpret_cast<const uint8_t *>(colors.data() + offset);
+    size_t bytes = width * sizeof(uint32_t);
+    uint16_t keep = persistence;
+    uint8_t differs = 0;
+    for (size_t n = 0; n < bytes; n++) {
+        uint8_t faded = static_cast<uint8_t>((previous[n] * keep) >> 8);
+        previous[n] = current[n] > faded ? current[n] : faded;
+        differs |= previous[n] ^ current[n];
+    }
+    return differs;
+}
+
+void Scaler::expandRow(const uint32_t *image, int row, uint32_t *pixels, int pitch) const {
+    // One run of a color per filtered pixel, then copies of the finished row
+    const uint32_t *in = image + static_cast<size_t>(row) * width;
+    auto *first = reinterpret_cast<uint8_t *>(pixels) + static_cast<size_t>(rowStarts[row]) * pitch;
+    uint32_t *out = reinterpret_cast<uint32_t *>(first);
+    for (int x = 0; x < width; x++) {
+        std::fill(out + columnStarts[x], out + columnStarts[x + 1], in[x]);
+    }
+    size_t rowBytes = columnStarts[width] * sizeof(uint32_t);
+    for (int y = rowStarts[row] + 1; y < rowStarts[row + 1]; y++) {
+        std::memcpy(reinterpret_cast<uint8_t *>(pixels) + static_cast<size_t>(y) * pitch, first, rowBytes);
+    }
+}
+
+ScaledRows Scaler::render(const Display &display, uint32_t *pixels, int pitch) {
+    if (width != display.getWidth() * factor || height != display.getHeight() * factor) {
+        resize(display);
+    }
+
+    // A display row is redone when it or, for the smoothing filters, a vertical neighbour changed
+    int rows = display.getHeight();
+    bool changed[Display::MAX_HEIGHT + 2]{};
+    for (int y = 0; y < rows; y++) {
+        changed[y + 1] = invalid || std::memcmp(display.planes[0][y], previous[0][y], sizeof(previous[0][y])) ||
+                         std::memcmp(display.planes[1][y], previous[1][y], sizeof(previous[1][y]));
+    }
+    std::memcpy(previous, display.planes, sizeof(previous));
+
+    const uint32_t *image = persistence ? glow.data() : colors.data();
+    ScaledRows result{rowStarts[height], 0};
+    for (int y = 0; y < rows; y++) {
+        bool dirty = changed[y + 1] || (factor > 1 && (changed[y] || changed[y + 2]));
+        if (dirty) {
+            smoothRow(display, y);
+        }
+        for (int row = y * factor; row < (y + 1) * factor; row++) {
+            bool update = dirty;
+            if (update) {
+                colorizeRow(row);
+            }
+            if (persistence && (update || fading[row])) {
+                fading[row] = blendRow(row);
+                update = true;
+            }
+            if (update) {
+                expandRow(image, row, pixels, pitch);
+                result.begin = std::min(result.begin, rowStarts[row]);
+                result.end = rowStarts[row + 1];
+            }
+        }
+    }
+    invalid = false;
+    return result;
+}
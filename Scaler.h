@@ -0,0 +1,78 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "Display.h"
+
+enum class ScaleFilter {
+    Nearest, // Plain pixel replication
+    Scale2x, // EPX/AdvMAME2x edge smoothing, then replication
+    Scale3x // AdvMAME3x edge smoothing, then replication
+};
+
+std::optional<ScaleFilter> parseScaleFilter(std::string_view name); // nearest, epx, scale2x or scale3x
+
+// Output rows [begin, end) rewritten by Scaler::render()
+struct ScaledRows {
+    int begin = 0;
+    int end = 0;
+
+    bool empty() const { return begin >= end; }
+};
+
+/*
+ * CPU upscaler from the packed framebuffer to 32-bit pixels.
+ * The edge-smoothing filters run on the bit planes 64 pixels at a time: neighbour
+ * comparisons are word-wide XOR/AND masks, so a 128x64 screen is 128 words per plane.
+ * The smoothed image (2x or 3x) is colored, optionally blended with the previous
+ * frames (phosphor persistence, which hides the flicker of XOR-drawn sprites) and
+ * replicated to the output size with run fills and row copies.
+ * Only rows whose neighbourhood changed since the last call, or that are still fading,
+ * are redone: the output buffer must persist between calls.
+ */
+class Scaler {
+    ScaleFilter filter;
+    int scale; // Output pixels per display pixel
+    int factor; // Filter magnification: 1, 2 or 3
+    uint8_t persistence = 0; // Share of the previous frame kept per channel, /256; 0 disables the blend
+    std::array<uint32_t, 4> palette; // Colors for plane bits 0..3
+    bool invalid = true; // Redo every row on the next call
+
+    int width = 0; // Filtered image size
+    int height = 0;
+    uint64_t previous[Display::PLANES][Display::MAX_HEIGHT][Display::WORDS]{}; // Display at the last call
+    std::vector<uint8_t> smoothed[Display::PLANES]; // Filtered bit planes, MSB-first bytes
+    std::vector<uint32_t> colors; // Filtered image
+    std::vector<uint32_t> glow; // Phosphor buffer, same size as colors
+    std::vector<uint8_t> fading; // Per filtered row: glow still differs from colors
+    std::vector<int> columnStarts; // First output column of every filtered column, plus the output width
+    std::vector<int> rowStarts; // Same for rows
+
+    void resize(const Display &display);
+    void smoothRow(const Display &display, int y); // Filter display row y into factor rows
+    void colorizeRow(int row);
+    bool blendRow(int row); // Returns true while the row is still fading
+    void expandRow(const uint32_t *image, int row, uint32_t *pixels, int pitch) const;
+
+public:
+    Scaler(ScaleFilter filter, int scale);
+
+    void setPalette(const std::array<uint32_t, 4> &colors) { palette = colors; invalid = true; }
+    void setPersistence(uint8_t value) { persistence = value; invalid = true; }
+
+    int outputWidth(const Display &display) const { return display.getWidth() * scale; }
+    int outputHeight(const Display &display) const { return display.getHeight() * scale; }
+
+    // Update outputWidth x outputHeight pixels, rows pitch bytes apart; rows outside the result keep the last frame
+    ScaledRows render(const Display &display, uint32_t *pixels, int pitch);
+};
+
+#endif //SCALER_H
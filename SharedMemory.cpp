@@ -0,0 +1,170 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "SharedMemory.h"
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+std::runtime_error systemError(const std::string &what, const std::string &name) {
+    return std::runtime_error(what + " " + name + ": " + std::strerror(errno));
+}
+
+// Whether an existing segment was left behind by an emulator that is no longer running
+bool isStale(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    bool stale = false;
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SharedState)) {
+        void *mapping = mmap(nullptr, sizeof(SharedState), PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED) {
+            const auto *state = static_cast<const SharedState *>(mapping);
+            // A segment still being set up has no magic yet and counts as in use
+            stale = state->magic == SharedState::MAGIC && state->pid != 0 &&
+                    kill(static_cast<pid_t>(state->pid), 0) < 0 && errno == ESRCH;
+            munmap(mapping, sizeof(SharedState));
+        }
+    }
+    close(fd);
+    return stale;
+}
+
+}
+
+SharedSegment::SharedSegment(const std::string &name, bool create) : name(name), owner(create) {
+    // The creator is the only owner: a name already taken is an error, never shared
+    fd = shm_open(name.c_str(), create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR, 0660);
+    if (fd < 0 && create && errno == EEXIST && isStale(name)) {
+        shm_unlink(name.c_str()); // Left behind by a crashed emulator
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    }
+    if (fd < 0 && create && errno == EEXIST) {
+        throw std::runtime_error("Shared memory name " + name + " is already in use");
+    }
+    if (fd < 0) {
+        throw systemError("Unable to open shared memory", name);
+    }
+    if (create && ftruncate(fd, sizeof(SharedState)) < 0) {
+        int error = errno;
+        close(fd);
+        shm_unlink(name.c_str());
+        errno = error;
+        throw systemError("Unable to size shared memory", name);
+    }
+    struct stat info{};
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(SharedState)) {
+        close(fd);
+        throw std::runtime_error("Shared memory " + name + " is not a CHIP-8 segment");
+    }
+    void *mapping = mmap(nullptr, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        throw systemError("Unable to map shared memory", name);
+    }
+    state = static_cast<SharedState *>(mapping);
+}
+
+SharedSegment::~SharedSegment() {
+    munmap(state, sizeof(SharedState));
+    close(fd);
+    if (owner) {
+        shm_unlink(name.c_str());
+    }
+}
+
+SharedHost::SharedHost(const std::string &name) : SharedSegment(name, true) {
+    std::memset(static_cast<void *>(state), 0, sizeof(SharedState));
+    state->version = SharedState::VERSION;
+    state->pid = static_cast<uint32_t>(getpid());
+    field(state->magic).store(SharedState::MAGIC, std::memory_order_release);
+}
+
+void SharedHost::publish(const Display &display) {
+    auto sequence = field(state->sequence);
+    uint32_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    field(state->width).store(display.getWidth(), std::memory_order_relaxed);
+    field(state->height).store(display.getHeight(), std::memory_order_relaxed);
+    field(state->frame).store(++frames, std::memory_order_relaxed);
+    const uint64_t *in = &display.planes[0][0][0];
+    uint64_t *out = &state->planes[0][0][0];
+    for (size_t n = 0; n < sizeof(state->planes) / sizeof(uint64_t); n++) {
+        std::atomic_ref<uint64_t>(out[n]).store(in[n], std::memory_order_relaxed);
+    }
+
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+void SharedHost::applyKeys(Chip8 &machine) {
+    uint16_t keys = static_cast<uint16_t>(field(state->keys).load(std::memory_order_acquire));
+    uint16_t changed = keys ^ appliedKeys;
+    for (int key = 0; changed; key++, changed >>= 1) {
+        if (changed & 1) {
+            machine.keypad[key] = (keys >> key) & 1;
+        }
+    }
+    appliedKeys = keys;
+}
+
+SharedClient::SharedClient(const std::string &name) : SharedSegment(name, false) {
+    if (field(state->magic).load(std::memory_order_acquire) != SharedState::MAGIC) {
+        throw std::runtime_error("Shared memory " + name + " is not a CHIP-8 segment");
+    }
+    if (state->version != SharedState::VERSION) {
+        throw std::runtime_error("Shared memory " + name + " has an unsupported version");
+    }
+}
+
+uint32_t SharedClient::readBegin() const {
+    uint32_t sequence;
+    while ((sequence = field(state->sequence).load(std::memory_order_acquire)) & 1) {
+        std::this_thread::yield();
+    }
+    return sequence;
+}
+
+bool SharedClient::readValid(uint32_t sequence) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return field(state->sequence).load(std::memory_order_relaxed) == sequence;
+}
+
+uint64_t SharedClient::readFrame(Display &display) const {
+    uint64_t planes[Display::PLANES][Display::MAX_HEIGHT][Display::WORDS];
+    uint32_t width, height;
+    uint64_t frame;
+    uint32_t sequence;
+    do {
+        sequence = readBegin();
+        width = field(state->width).load(std::memory_order_relaxed);
+        height = field(state->height).load(std::memory_order_relaxed);
+        frame = field(state->frame).load(std::memory_order_relaxed);
+        const uint64_t *in = &state->planes[0][0][0];
+        uint64_t *out = &planes[0][0][0];
+        for (size_t n = 0; n < sizeof(planes) / sizeof(uint64_t); n++) {
+            out[n] = field(in[n]).load(std::memory_order_relaxed);
+        }
+    } while (!readValid(sequence));
+
+    if (frame && (display.getWidth() != static_cast<int>(width) || display.getHeight() != static_cast<int>(height))) {
+        display.resize(static_cast<int>(width), static_cast<int>(height));
+    }
+    std::memcpy(display.planes, planes, sizeof(planes));
+    display.rehash();
+    return frame;
+}
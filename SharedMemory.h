@@ -0,0 +1,112 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Chip8.h"
+#include "Display.h"
+
+/*
+ * Layout of the shared-memory segment, with fixed offsets so clients in any language can
+ * map it. Every field is accessed atomically; multi-byte values are native endian.
+ * The frame block is written by the emulator and guarded by a seqlock: sequence is odd
+ * while a frame is being written, and a reader whose copy spans a change of sequence
+ * retries. The input/control block is written by clients and sits on its own cache line.
+ */
+struct SharedState {
+    static constexpr uint32_t MAGIC = 0x4D533843; // "C8SM"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic; // Written last when the emulator creates the segment
+    uint32_t version;
+    uint32_t pid; // Emulator process
+    uint32_t halted; // Nonzero once the program exited (00FD)
+
+    // Frame, emulator -> clients
+    alignas(64) uint32_t sequence;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+    uint64_t frame; // Frames published so far
+    uint64_t planes[Display::PLANES][Display::MAX_HEIGHT][Display::WORDS]; // Same packing as Display
+
+    // Input and control, clients -> emulator
+    alignas(64) uint32_t keys; // Bit n: key n held
+    uint32_t paused; // Nonzero: emulation stopped; the emulator mirrors local pauses here
+    uint32_t instructionsPerFrame; // 0: the emulator's default speed
+};
+
+static_assert(offsetof(SharedState, sequence) == 64);
+static_assert(offsetof(SharedState, frame) == 80);
+static_assert(offsetof(SharedState, planes) == 88);
+static_assert(offsetof(SharedState, keys) == 2176);
+static_assert(offsetof(SharedState, instructionsPerFrame) == 2184);
+
+// Mapping of a named POSIX shared-memory segment (shm_open name, e.g. "/chip8")
+class SharedSegment {
+protected:
+    std::string name;
+    int fd = -1;
+    SharedState *state = nullptr;
+    bool owner; // Created the segment (exclusively), unlinks it on destruction
+
+    SharedSegment(const std::string &name, bool create);
+    ~SharedSegment();
+
+    template <typename T>
+    static std::atomic_ref<T> field(const T &value) { return std::atomic_ref<T>(const_cast<T &>(value)); }
+
+public:
+    SharedSegment(const SharedSegment&) = delete;
+    SharedSegment& operator=(const SharedSegment&) = delete;
+};
+
+/*
+ * Emulator side: creates the segment, publishes a frame after every emulated frame and
+ * picks up the input and control words. Publishing is a 2 KB copy, reading the input a
+ * couple of atomic loads, so the frontend calls them unconditionally.
+ */
+class SharedHost : public SharedSegment {
+    uint16_t appliedKeys = 0; // Client key mask at the last applyKeys()
+    uint64_t frames = 0;
+
+public:
+    explicit SharedHost(const std::string &name);
+
+    void publish(const Display &display);
+    void applyKeys(Chip8 &machine); // Press or release the keys clients changed since the last call
+    bool isPaused() const { return field(state->paused).load(std::memory_order_acquire); }
+    void setPaused(bool paused) { field(state->paused).store(paused, std::memory_order_release); }
+    int getInstructionsPerFrame() const { return static_cast<int>(field(state->instructionsPerFrame).load(std::memory_order_relaxed)); }
+    uint16_t getKeys() const { return static_cast<uint16_t>(field(state->keys).load(std::memory_order_acquire)); } // Client key mask
+    void setHalted() { field(state->halted).store(1, std::memory_order_release); }
+};
+
+/*
+ * Client side: attaches to a running emulator. Frames can be read in place through
+ * view() between readBegin() and readValid(), or copied with readFrame().
+ */
+class SharedClient : public SharedSegment {
+public:
+    explicit SharedClient(const std::string &name);
+
+    const SharedState &view() const { return *state; }
+    uint32_t readBegin() const; // Waits out a frame being written, returns the sequence to validate
+    bool readValid(uint32_t sequence) const; // True if nothing was written since readBegin()
+    uint64_t readFrame(Display &display) const; // Consistent copy of the latest frame, returns its number
+
+    void setKeys(uint16_t keys) { field(state->keys).store(keys, std::memory_order_release); }
+    void pressKey(int key) { field(state->keys).fetch_or(1u << (key & 0xF), std::memory_order_acq_rel); }
+    void releaseKey(int key) { field(state->keys).fetch_and(~(1u << (key & 0xF)), std::memory_order_acq_rel); }
+    void setPaused(bool paused) { field(state->paused).store(paused, std::memory_order_release); }
+    void setInstructionsPerFrame(int instructions) { field(state->instructionsPerFrame).store(instructions, std::memory_order_relaxed); }
+    bool isHalted() const { return field(state->halted).load(std::memory_order_acquire); }
+};
+
+#endif //SHAREDMEMORY_H
@@ -0,0 +1,36 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef STATEHASH_H
+#define STATEHASH_H
+
+#include <cstdint>
+
+/*
+ * Building blocks for incremental state hashes.
+ * A buffer's hash is the wrapping sum of elementHash(position, value) over its elements,
+ * so a write updates it with one subtraction and one addition instead of a rehash.
+ * Zero elements contribute nothing, which makes cleared memory and a blank screen hash to 0.
+ */
+
+// splitmix64 finalizer: every input bit affects every output bit
+constexpr uint64_t mixHash(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+constexpr uint64_t elementHash(uint64_t position, uint64_t value) {
+    return value ? mixHash(value ^ mixHash(position + 0x9E3779B97F4A7C15ULL)) : 0;
+}
+
+// Order-dependent combination of two hashes
+constexpr uint64_t combineHash(uint64_t seed, uint64_t value) {
+    return mixHash(seed ^ (value + 0x9E3779B97F4A7C15ULL + (seed << 6) + (seed >> 2)));
+}
+
+#endif //STATEHASH_H
@@ -10,10 +10,15 @@
 class SuperChip : public Chip8 {
     private:
       bool hiRes = false;
-    uint8_t RPL[16] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    protected:
+      uint8_t RPL[16] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+      int rplLimit() const { return mode == Mode::XOCHIP ? 15 : 7; } // Highest usable RPL flag
+      uint64_t extraStateHash() const override;
+      explicit SuperChip(uint8_t *memory, uint32_t capacity = MEMORY_SIZE);
+      SuperChip(const SuperChip &) = default;
+      SuperChip &operator=(const SuperChip &) = default;
     public:
-      SuperChip();
       void enableHiRes();
       void disableHiRes();
       bool isHiRes() { return hiRes; }
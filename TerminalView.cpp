@@ -0,0 +1,185 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "TerminalView.h"
+#include <cerrno>
+#include <iostream>
+#include <unistd.h>
+
+namespace {
+
+// Colors of plane bits 0..3, as the Scaler's palette: black, white, light and dark gray
+constexpr int FOREGROUND[4] = {30, 97, 37, 90};
+constexpr int BACKGROUND[4] = {40, 107, 47, 100};
+
+// Quarter blocks by mask: bit 0 top left, bit 1 top right, bit 2 bottom left, bit 3 bottom right
+constexpr const char *QUARTERS[16] = {
+    " ", "▘", "▝", "▀", "▖", "▌", "▞", "▛",
+    "▗", "▚", "▐", "▜", "▄", "▙", "▟", "█"
+};
+constexpr const char *UPPER_HALF = "▀";
+
+// Keys laid out as in the SDL frontend: 1234 / QWER / ASDF / ZXCV
+int keyFor(char c) {
+    switch (c) {
+        case '1': return 0x1; case '2': return 0x2; case '3': return 0x3; case '4': return 0xC;
+        case 'q': case 'Q': return 0x4; case 'w': case 'W': return 0x5; case 'e': case 'E': return 0x6; case 'r': case 'R': return 0xD;
+        case 'a': case 'A': return 0x7; case 's': case 'S': return 0x8; case 'd': case 'D': return 0x9; case 'f': case 'F': return 0xE;
+        case 'z': case 'Z': return 0xA; case 'x': case 'X': return 0x0; case 'c': case 'C': return 0xB; case 'v': case 'V': return 0xF;
+        default: return -1;
+    }
+}
+
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+NullBuffer silence;
+
+}
+
+TerminalView::TerminalView(TerminalBlocks blocks) : blocks(blocks) {
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &savedMode) == 0) {
+        termios raw = savedMode;
+        raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+        raw.c_iflag &= ~(IXON | ICRNL);
+        raw.c_cc[VMIN] = 0; // read() returns at once with whatever was typed
+        raw.c_cc[VTIME] = 0;
+        rawInput = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+    }
+    savedCout = std::cout.rdbuf(&silence);
+    out = "\x1b[?1049h\x1b[?25l"; // Alternate screen, hidden cursor
+    flush();
+}
+
+TerminalView::~TerminalView() {
+    out = "\x1b[0m\x1b[?25h\x1b[?1049l";
+    flush();
+    std::cout.rdbuf(savedCout);
+    if (rawInput) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &savedMode);
+    }
+}
+
+uint8_t TerminalView::cellCode(const Display &display, int column, int row) const {
+    if (blocks == TerminalBlocks::Half) {
+        int y = row * 2;
+        return static_cast<uint8_t>(display.getPixel(column, y) | display.getPixel(column, y + 1) << 2);
+    }
+    int x = column * 2;
+    int y = row * 2;
+    return static_cast<uint8_t>((display.getPixel(x, y) != 0) | (display.getPixel(x + 1, y) != 0) << 1 |
+                                (display.getPixel(x, y + 1) != 0) << 2 | (display.getPixel(x + 1, y + 1) != 0) << 3);
+}
+
+void TerminalView::appendCell(uint8_t code, int &foreground, int &background) {
+    if (blocks == TerminalBlocks::Quarter) {
+        out += QUARTERS[code];
+        return;
+    }
+    int top = code & 3;
+    int bottom = code >> 2;
+    // A uniform cell is a space, so only its background color matters
+    int wantForeground = top == bottom ? foreground : FOREGROUND[top];
+    int wantBackground = BACKGROUND[bottom];
+    if (wantForeground != foreground && wantBackground != background) {
+        out += "\x1b[" + std::to_string(wantForeground) + ";" + std::to_string(wantBackground) + "m";
+    } else if (wantForeground != foreground || wantBackground != background) {
+        out += "\x1b[" + std::to_string(wantForeground != foreground ? wantForeground : wantBackground) + "m";
+    }
+    foreground = wantForeground;
+    background = wantBackground;
+    out += top == bottom ? " " : UPPER_HALF;
+}
+
+void TerminalView::render(const Display &display, bool soundOn) {
+    out.clear();
+    if (soundOn && !soundWasOn) {
+        out += '\a';
+    }
+    soundWasOn = soundOn;
+
+    int width = blocks == TerminalBlocks::Half ? display.getWidth() : display.getWidth() / 2;
+    int height = display.getHeight() / 2;
+    if (width != columns || height != rows) {
+        // First frame or resolution switch: start from a blank screen
+        columns = width;
+        rows = height;
+        cells.assign(static_cast<size_t>(columns) * rows, UNKNOWN);
+        out += "\x1b[0m\x1b[2J";
+    } else if (display.getHash() == shownHash) {
+        flush();
+        return;
+    }
+    shownHash = display.getHash();
+
+    int foreground = -1; // Unknown at the start of every frame
+    int background = -1;
+    if (blocks == TerminalBlocks::Quarter) {
+        out += "\x1b[97;40m";
+    }
+    for (int row = 0; row < rows; row++) {
+        int cursor = -1; // Column the terminal cursor is at in this row, -1: elsewhere
+        for (int column = 0; column < columns; column++) {
+            uint8_t code = cellCode(display, column, row);
+            uint8_t &shown = cells[static_cast<size_t>(row) * columns + column];
+            if (code == shown) {
+                continue;
+            }
+            shown = code;
+            if (cursor != column) {
+                out += "\x1b[" + std::to_string(row + 1) + ";" + std::to_string(column + 1) + "H";
+            }
+            appendCell(code, foreground, background);
+            cursor = column + 1;
+        }
+    }
+    flush();
+}
+
+void TerminalView::flush() {
+    const char *data = out.data();
+    size_t left = out.size();
+    while (left) {
+        ssize_t written = write(STDOUT_FILENO, data, left);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            break; // Closed terminal: nothing to draw on
+        }
+        data += written;
+        left -= static_cast<size_t>(written);
+    }
+    out.clear();
+}
+
+TerminalInput TerminalView::poll() {
+    TerminalInput input;
+    for (int &frames : held) {
+        frames = frames > 0 ? frames - 1 : 0;
+    }
+    char buffer[64];
+    ssize_t length;
+    while (rawInput && (length = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < length; i++) {
+            char c = buffer[i];
+            if (c == 0x1B) {
+                break; // Escape sequence (arrows, function keys): not part of the keypad
+            }
+            if (c == 0x03 || c == 0x04) {
+                input.quit = true;
+            } else if (c == ' ') {
+                input.pauseToggled = true;
+            } else if (int key = keyFor(c); key >= 0) {
+                held[key] = HOLD_FRAMES;
+            }
+        }
+    }
+    for (int key = 0; key < 16; key++) {
+        if (held[key]) {
+            input.keys |= static_cast<uint16_t>(1 << key);
+        }
+    }
+    return input;
+}
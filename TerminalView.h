@@ -0,0 +1,67 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef TERMINALVIEW_H
+#define TERMINALVIEW_H
+
+#include <cstdint>
+#include <string>
+#include <termios.h>
+#include <vector>
+#include "Display.h"
+
+enum class TerminalBlocks {
+    Half, // One cell per 1x2 pixels, exact XO-CHIP colors
+    Quarter // One cell per 2x2 pixels, monochrome; a 128x64 screen fits in 64x32 cells
+};
+
+// Keypad and controls read from the terminal since the last poll()
+struct TerminalInput {
+    uint16_t keys = 0; // Bit n: key n held
+    bool pauseToggled = false; // Space
+    bool quit = false; // Ctrl-C or Ctrl-D; the terminal does not send signals in raw mode
+};
+
+/*
+ * Frontend for terminals over SSH: draws the display with Unicode block characters and
+ * ANSI colors and reads the keypad from stdin in raw mode.
+ * render() keeps the cells on screen and emits only those that changed, with cursor jumps
+ * over unchanged runs and color codes only when the color changes, then sends the whole
+ * frame with one write(). An unchanged display costs nothing, a moving sprite a few dozen
+ * bytes. Terminals report key presses but not releases, so a key counts as held for
+ * HOLD_FRAMES frames after its last press (auto-repeat keeps it held).
+ * While the view exists, std::cout is silenced so core messages don't scroll the screen.
+ */
+class TerminalView {
+    static constexpr int HOLD_FRAMES = 8;
+    static constexpr uint8_t UNKNOWN = 0xFF; // Cell contents not known: redraw
+
+    TerminalBlocks blocks;
+    bool rawInput = false; // stdin is a terminal we switched to raw mode
+    termios savedMode{};
+    std::streambuf *savedCout = nullptr;
+    int columns = 0; // Cells on screen
+    int rows = 0;
+    std::vector<uint8_t> cells; // Cell codes on screen, row-major
+    uint64_t shownHash = 0; // Display hash of the frame on screen
+    bool soundWasOn = false;
+    int held[16]{}; // Frames each key stays held
+    std::string out; // Frame being assembled
+
+    uint8_t cellCode(const Display &display, int column, int row) const;
+    void appendCell(uint8_t code, int &foreground, int &background);
+    void flush();
+
+public:
+    explicit TerminalView(TerminalBlocks blocks);
+    ~TerminalView();
+
+    TerminalView(const TerminalView&) = delete;
+    TerminalView& operator=(const TerminalView&) = delete;
+
+    void render(const Display &display, bool soundOn); // soundOn: ring the bell when a tone starts
+    TerminalInput poll(); // Once per frame
+};
+
+#endif //TERMINALVIEW_H
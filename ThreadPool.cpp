@@ -0,0 +1,90 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::runIndices() {
+    for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+        try {
+            (*body)(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+}
+
+void ThreadPool::work() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        runIndices();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+        }
+        finished.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &body) {
+    if (workers.empty() || count <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->body = &body;
+        this->count = count;
+        next = 0;
+        busy = workers.size();
+        error = nullptr;
+        generation++;
+    }
+    wake.notify_all();
+    runIndices();
+
+    std::exception_ptr thrown;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return busy == 0; });
+        this->body = nullptr;
+        thrown = error;
+    }
+    if (thrown) {
+        std::rethrow_exception(thrown);
+    }
+}
@@ -0,0 +1,51 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads for data-parallel loops over independent machines.
+ * parallelFor() hands out indices through an atomic counter, so uneven work (a machine
+ * stuck in FX0A next to one drawing every frame) balances itself; the calling thread
+ * takes part and returns once every index has run.
+ */
+class ThreadPool {
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake; // Workers: a new loop was posted or the pool is stopping
+    std::condition_variable finished; // Caller: the last worker left the current loop
+
+    const std::function<void(size_t)> *body = nullptr; // Current loop, valid while it runs
+    size_t count = 0;
+    std::atomic<size_t> next{0}; // Next index to hand out
+    size_t busy = 0; // Workers still inside the current loop
+    uint64_t generation = 0; // Bumped for every loop so each worker joins it once
+    bool stopping = false;
+    std::exception_ptr error; // First exception thrown by the body
+
+    void work(); // Worker thread
+    void runIndices(); // Pull indices until none are left
+
+public:
+    explicit ThreadPool(size_t threads = 0); // Total threads including the caller, 0: one per core
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size() + 1; }
+    void parallelFor(size_t count, const std::function<void(size_t)> &body); // Run body(0..count-1), rethrow the first error
+};
+
+#endif //THREADPOOL_H
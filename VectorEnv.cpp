@@ -0,0 +1,75 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "VectorEnv.h"
+#include <stdexcept>
+#include "RomLoader.h"
+
+VectorEnv::VectorEnv(const std::vector<uint8_t> &rom, Mode mode, size_t count, int frameskip,
+                     int instructionsPerFrame, size_t threads)
+    : frameskip(frameskip), instructionsPerFrame(instructionsPerFrame), done(count, 0), pool(threads) {
+    if (count == 0) {
+        throw std::runtime_error("Environment needs at least one instance");
+    }
+    if (frameskip < 1 || instructionsPerFrame < 1) {
+        throw std::runtime_error("Frameskip and instructions per frame must be positive");
+    }
+
+    std::unique_ptr<Chip8> initial = createMachine(mode);
+    initial->loadROM(rom.data(), rom.size());
+    initial->setCyclesPerSecond(instructionsPerFrame * 60); // A frame is one timer tick
+    machines = std::make_unique<MachineArena>(*initial, count);
+    reset(0);
+}
+
+void VectorEnv::enableCache(size_t capacity, bool verify) {
+    cache = capacity ? std::make_unique<FrameCache>(capacity, instructionsPerFrame, verify) : nullptr;
+}
+
+std::unique_ptr<Chip8> VectorEnv::snapshot(size_t i) const {
+    if (i >= size()) {
+        throw std::out_of_range("Instance index out of range");
+    }
+    return machine(i).clone();
+}
+
+void VectorEnv::restore(size_t i, const Chip8 &snapshot) {
+    if (i >= size()) {
+        throw std::out_of_range("Instance index out of range");
+    }
+    machine(i).restore(snapshot);
+}
+
+void VectorEnv::resetInstance(size_t i) {
+    machines->reset(i);
+    machine(i).setSeed(seed + static_cast<uint32_t>(i));
+}
+
+void VectorEnv::reset(uint32_t seed) {
+    this->seed = seed;
+    pool.parallelFor(size(), [this](size_t i) {
+        resetInstance(i);
+        done[i] = 0;
+    });
+}
+
+void VectorEnv::step(const uint16_t *actions) {
+    pool.parallelFor(size(), [this, actions](size_t i) {
+        Chip8 &m = machine(i);
+        if (cache) {
+            thread_local std::vector<uint16_t> chunk; // Reused, steps allocate only on cache misses
+            chunk.assign(frameskip, actions[i]);
+            cache->run(m, chunk.data(), chunk.size());
+        } else {
+            m.setKeys(actions[i]);
+            for (int frame = 0; frame < frameskip && !m.isHalted(); frame++) {
+                m.runFrame(instructionsPerFrame);
+            }
+        }
+        done[i] = m.isHalted();
+        if (done[i]) {
+            resetInstance(i); // Auto-reset, the next observation starts a new episode
+        }
+    });
+}
@@ -0,0 +1,54 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef VECTORENV_H
+#define VECTORENV_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "FrameCache.h"
+#include "MachineArena.h"
+#include "ThreadPool.h"
+
+/*
+ * N headless machines running the same ROM, stepped together (Gym-style vector environment).
+ * The machines live in a MachineArena, so every framebuffer sits at a fixed stride from the
+ * first one and a batch of observations is a strided view of the machines themselves rather
+ * than a copy. step() runs the instances on a thread pool; without the cache, stepping and
+ * resetting never allocate.
+ */
+class VectorEnv {
+    std::unique_ptr<MachineArena> machines; // Prototype: ROM loaded, the state reset() returns to
+    int frameskip; // Frames per step
+    int instructionsPerFrame;
+    uint32_t seed = 0;
+    std::vector<uint8_t> done; // Halted during the last step (then reset automatically)
+    ThreadPool pool;
+    std::unique_ptr<FrameCache> cache; // Optional memoization of steps
+
+    void resetInstance(size_t i);
+
+public:
+    VectorEnv(const std::vector<uint8_t> &rom, Mode mode, size_t count, int frameskip = 4,
+              int instructionsPerFrame = 8, size_t threads = 0);
+
+    size_t size() const { return machines->size(); }
+    Mode getMode() const { return machines->getPrototype().getMode(); }
+    Chip8 &machine(size_t i) { return (*machines)[i]; }
+    const Chip8 &machine(size_t i) const { return (*machines)[i]; }
+    size_t stride() const { return machines->stride(); } // Bytes between consecutive machines
+
+    void reset(uint32_t seed); // All instances back to the loaded ROM; instance i uses seed + i
+    void step(const uint16_t *actions); // One key mask per instance (bit n = key n held), then run frameskip frames
+    const std::vector<uint8_t> &getDone() const { return done; }
+    void enableCache(size_t capacity, bool verify = false); // Memoize steps by (state hash, action); 0 disables
+    const FrameCache *getCache() const { return cache.get(); }
+
+    std::unique_ptr<Chip8> snapshot(size_t i) const; // Copy of instance i
+    void restore(size_t i, const Chip8 &snapshot); // Instance i back to a snapshot of the same core type
+};
+
+#endif //VECTORENV_H
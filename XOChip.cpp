@@ -0,0 +1,70 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include "XOChip.h"
+#include <cmath>
+#include <cstdlib>
+
+XOChip::XOChip(uint8_t *memory) : SuperChip(memory, MEMORY_SIZE) {
+    setMode(Mode::XOCHIP);
+}
+
+uint64_t XOChip::extraStateHash() const {
+    uint64_t hash = combineHash(SuperChip::extraStateHash(), pitch);
+    for (uint8_t sample : audioPattern) {
+        hash = combineHash(hash, sample);
+    }
+    return hash;
+}
+
+double XOChip::getPlaybackRate() const {
+    return 4000.0 * std::pow(2.0, (pitch - 64) / 48.0);
+}
+
+void XOChip::execute(Instruction i) {
+    switch (decodeOp(i)) {
+        case Op::ScrollUp:
+            // Scroll up by N pixels
+            display.scrollUp(i.n, planeMask);
+            return;
+        case Op::SaveRange:
+        case Op::LoadRange: {
+            // Save (5XY2) or load (5XY3) Vx..Vy at I, in either direction; I is not modified
+            int step = i.x <= i.y ? 1 : -1;
+            int count = std::abs(i.y - i.x) + 1;
+            for (int j = 0; j < count; j++) {
+                uint8_t reg = i.x + j * step;
+                uint16_t address = (index + j) & memoryMask;
+                if (i.n == 0x2) {
+                    storeByte(address, V[reg]);
+                } else {
+                    V[reg] = memory[address];
+                }
+            }
+            return;
+        }
+        case Op::LongI:
+            // Load the 16-bit address following this instruction into I
+            index = (memory[pc] << 8) | memory[static_cast<uint16_t>(pc + 1)];
+            pc = (pc + 2) & memoryMask;
+            return;
+        case Op::Plane:
+            // Select bit planes N for drawing, clearing and scrolling
+            planeMask = i.x & 0x3;
+            return;
+        case Op::Audio:
+            // Load 16 bytes at I into the audio pattern buffer
+            for (int j = 0; j < 16; j++) {
+                audioPattern[j] = memory[static_cast<uint16_t>(index + j)];
+            }
+            return;
+        case Op::Pitch:
+            // Set the audio pitch register to Vx
+            pitch = V[i.x];
+            return;
+        default:
+            break;
+    }
+    SuperChip::execute(i); // Call the base class execute method
+}
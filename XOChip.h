@@ -0,0 +1,38 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#ifndef XOCHIP_H
+#define XOCHIP_H
+#include "SuperChip.h"
+
+
+class XOChip : public SuperChip {
+    /*
+     * XO-CHIP extends SUPER-CHIP with:
+     * 64 KB of addressable memory, reached through the 4-byte F000 NNNN "long I" instruction
+     * A second display bit plane (4 colors), selected with FN01
+     * 5XY2/5XY3 to save/load a range of registers without touching I
+     * A 16-byte 1-bit audio pattern buffer (F002) played back at a rate set by the pitch register (FX3A)
+     */
+    uint8_t audioPattern[16]{}; // 128 1-bit samples
+    uint8_t pitch = 64; // Playback rate is 4000 * 2^((pitch - 64) / 48) Hz
+
+    protected:
+      uint64_t extraStateHash() const override;
+      explicit XOChip(uint8_t *memory);
+      XOChip(const XOChip &) = default;
+      XOChip &operator=(const XOChip &) = default;
+
+    public:
+      static constexpr uint32_t MEMORY_SIZE = 0x10000;
+
+      void execute(Instruction i) override;
+      const uint8_t *getAudioPattern() const { return audioPattern; }
+      uint8_t getPitch() const { return pitch; }
+      double getPlaybackRate() const; // Audio pattern bits per second
+};
+
+
+
+#endif //XOCHIP_H
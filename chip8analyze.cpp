@@ -0,0 +1,84 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include "Analyzer.h"
+#include "RomLoader.h"
+
+struct AnalyzeConfig {
+    std::string romPath;
+    std::optional<Mode> chipType; // Empty: detect from the ROM
+    bool dot = false;
+    std::string outputPath; // Empty: stdout
+};
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options] <rom_path>\n"
+              << "Options:\n"
+              << "  --chip <type>      Chip type (auto, chip8, schip10, schip11, superchip or xochip) [default: auto]\n"
+              << "  --format <fmt>     Output format (json or dot) [default: json]\n"
+              << "  -o <path>          Write output to a file instead of stdout\n"
+              << "  --help             Show this help message\n";
+}
+
+AnalyzeConfig parseCommandLine(int argc, char* argv[]) {
+    AnalyzeConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+        if (arg == "--help") {
+            printUsage(argv[0]);
+            std::exit(0);
+        } else if (arg == "--chip" && i + 1 < argc) {
+            config.chipType = parseMode(argv[++i]);
+        } else if (arg == "--format" && i + 1 < argc) {
+            std::string_view format(argv[++i]);
+            if (format != "json" && format != "dot") {
+                throw std::runtime_error("Invalid format. Use 'json' or 'dot'");
+            }
+            config.dot = format == "dot";
+        } else if (arg == "-o" && i + 1 < argc) {
+            config.outputPath = argv[++i];
+        } else if (config.romPath.empty()) {
+            config.romPath = arg;
+        } else {
+            throw std::runtime_error("Unexpected argument: " + std::string(arg));
+        }
+    }
+    if (config.romPath.empty()) {
+        printUsage(argv[0]);
+        throw std::runtime_error("ROM path is required");
+    }
+    return config;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        AnalyzeConfig config = parseCommandLine(argc, argv);
+        std::vector<uint8_t> rom = readROMFile(config.romPath);
+
+        Mode mode = config.chipType ? *config.chipType : detectMode(rom.data(), rom.size());
+
+        Analysis analysis = analyzeROM(rom.data(), rom.size(), mode);
+        std::string output = config.dot ? analysisToDOT(analysis) : analysisToJSON(analysis);
+
+        if (config.outputPath.empty()) {
+            std::cout << output;
+        } else {
+            std::ofstream file(config.outputPath);
+            if (!file) {
+                throw std::runtime_error("Unable to open output file: " + config.outputPath);
+            }
+            file << output;
+        }
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,483 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include "Debugger.h"
+#include "RomLoader.h"
+
+struct ConformConfig {
+    std::string romPath;
+    std::optional<Mode> chipType; // Empty: detect from the ROM
+    std::string moviePath; // Empty: no keys pressed
+    uint32_t frames = 600;
+    int instructionsPerFrame = 8; // Matches the emulator's 500 Hz at 60 Hz
+    bool everyFrame = false; // Compare after every frame instead of every instruction
+    uint32_t seed = 1;
+    std::vector<std::string> checks; // Empty: all
+};
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options] <rom_path>\n"
+              << "Options:\n"
+              << "  --chip <type>      Chip type (auto, chip8, schip10, schip11, superchip or xochip) [default: auto]\n"
+              << "  --check <name>     Comparison to run: cores, dispatch, fusion or display (repeatable) [default: all]\n"
+              << "  --movie <path>     Input movie, one \"<frame> <hex key mask>\" per line\n"
+              << "  --frames <n>       Frames to run [default: 600]\n"
+              << "  --ipf <n>          Instructions per frame [default: 8]\n"
+              << "  --every <unit>     Compare after every instruction or frame [default: instruction]\n"
+              << "  --seed <n>         Seed for CXNN, shared by both engines [default: 1]\n"
+              << "  --help             Show this help message\n";
+}
+
+ConformConfig parseCommandLine(int argc, char* argv[]) {
+    ConformConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+        if (arg == "--help") {
+            printUsage(argv[0]);
+            std::exit(0);
+        } else if (arg == "--chip" && i + 1 < argc) {
+            config.chipType = parseMode(argv[++i]);
+        } else if (arg == "--check" && i + 1 < argc) {
+            std::string check(argv[++i]);
+            if (check != "cores" && check != "dispatch" && check != "fusion" && check != "display") {
+                throw std::runtime_error("Invalid check. Use 'cores', 'dispatch', 'fusion' or 'display'");
+            }
+            config.checks.push_back(check);
+        } else if (arg == "--movie" && i + 1 < argc) {
+            config.moviePath = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            config.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--ipf" && i + 1 < argc) {
+            config.instructionsPerFrame = std::stoi(argv[++i]);
+            if (config.instructionsPerFrame < 1) {
+                throw std::runtime_error("Instructions per frame must be positive");
+            }
+        } else if (arg == "--every" && i + 1 < argc) {
+            std::string_view unit(argv[++i]);
+            if (unit != "instruction" && unit != "frame") {
+                throw std::runtime_error("Invalid unit. Use 'instruction' or 'frame'");
+            }
+            config.everyFrame = unit == "frame";
+        } else if (arg == "--seed" && i + 1 < argc) {
+            config.seed = static_cast<uint32_t>(std::stoul(argv[++i], nullptr, 0));
+        } else if (config.romPath.empty()) {
+            config.romPath = arg;
+        } else {
+            throw std::runtime_error("Unexpected argument: " + std::string(arg));
+        }
+    }
+    if (config.romPath.empty()) {
+        printUsage(argv[0]);
+        throw std::runtime_error("ROM path is required");
+    }
+    return config;
+}
+
+std::string hex(uint32_t value, int width = 3) {
+    std::stringstream ss;
+    ss << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(width) << value;
+    return ss.str();
+}
+
+// Keypad state over time: each event sets all 16 keys from its frame on
+class InputMovie {
+    std::vector<std::pair<uint32_t, uint16_t>> events; // (frame, key mask), sorted by frame
+
+public:
+    static InputMovie load(const std::string &path) {
+        InputMovie movie;
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Unable to open input movie: " + path);
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            uint32_t frame;
+            std::string mask;
+            if (!(fields >> frame)) {
+                continue; // Blank or comment
+            }
+            if (!(fields >> mask)) {
+                throw std::runtime_error("Invalid input movie line: " + line);
+            }
+            movie.events.emplace_back(frame, static_cast<uint16_t>(std::stoul(mask, nullptr, 16)));
+        }
+        std::stable_sort(movie.events.begin(), movie.events.end(),
+                         [](const auto &a, const auto &b) { return a.first < b.first; });
+        return movie;
+    }
+
+    uint16_t keysAt(uint32_t frame) const {
+        uint16_t keys = 0;
+        for (const auto &[start, mask] : events) {
+            if (start > frame) {
+                break;
+            }
+            keys = mask;
+        }
+        return keys;
+    }
+};
+
+std::unique_ptr<Chip8> loadMachine(std::unique_ptr<Chip8> machine, const std::vector<uint8_t> &rom, Mode mode,
+                                   const ConformConfig &config) {
+    machine->loadROM(rom.data(), rom.size());
+    machine->setMode(mode);
+    machine->setSeed(config.seed);
+    machine->setCyclesPerSecond(config.instructionsPerFrame * 60); // A frame is one timer tick
+    return machine;
+}
+
+// Rows that differ between two framebuffers, drawn side by side
+std::string framebufferDiff(int width, int height, const std::function<bool(int, int)> &a,
+                            const std::function<bool(int, int)> &b, const std::string &nameA, const std::string &nameB) {
+    std::stringstream out;
+    int shown = 0;
+    for (int y = 0; y < height; y++) {
+        std::string rowA, rowB;
+        for (int x = 0; x < width; x++) {
+            rowA += a(x, y) ? '#' : '.';
+            rowB += b(x, y) ? '#' : '.';
+        }
+        if (rowA == rowB) {
+            continue;
+        }
+        if (shown++ == 8) {
+            out << "  ...\n";
+            break;
+        }
+        out << "  y=" << std::setw(2) << y << " " << nameA << ": " << rowA << "\n"
+            << "       " << std::string(nameA.size(), ' ') << "  " << rowB << " (" << nameB << ")\n";
+    }
+    return out.str();
+}
+
+// Register, memory and framebuffer differences; empty when the machines agree
+std::string stateDiff(const Chip8 &a, const Chip8 &b, const std::string &nameA, const std::string &nameB) {
+    std::stringstream out;
+    auto field = [&](const std::string &name, uint32_t valueA, uint32_t valueB) {
+        if (valueA != valueB) {
+            out << "  " << name << ": " << hex(valueA, 2) << " (" << nameA << ") vs " << hex(valueB, 2) << " (" << nameB << ")\n";
+        }
+    };
+    for (int r = 0; r < 16; r++) {
+        std::stringstream name;
+        name << "V" << std::hex << std::uppercase << r;
+        field(name.str(), a.getV(r), b.getV(r));
+    }
+    field("PC", a.getPC(), b.getPC());
+    field("I", a.getIndex(), b.getIndex());
+    field("SP", a.getSP(), b.getSP());
+    for (int level = 0; level < std::min(a.getSP(), b.getSP()); level++) {
+        field("stack[" + std::to_string(level) + "]", a.getStack(level), b.getStack(level));
+    }
+    field("DT", a.getDelayTimer(), b.getDelayTimer());
+    field("ST", a.getSoundTimer(), b.getSoundTimer());
+
+    int differing = 0;
+    uint32_t size = std::min(a.memorySize(), b.memorySize());
+    for (uint32_t address = 0; address < size; address++) {
+        uint8_t byteA = a.readMemory(static_cast<uint16_t>(address));
+        uint8_t byteB = b.readMemory(static_cast<uint16_t>(address));
+        if (byteA != byteB && differing++ < 16) {
+            out << "  [" << hex(address, 4) << "]: " << hex(byteA, 2) << " vs " << hex(byteB, 2) << "\n";
+        }
+    }
+    if (differing > 16) {
+        out << "  ... " << differing << " bytes differ\n";
+    }
+
+    if (a.display.getWidth() != b.display.getWidth() || a.display.getHeight() != b.display.getHeight()) {
+        out << "  display: " << a.display.getWidth() << "x" << a.display.getHeight() << " vs "
+            << b.display.getWidth() << "x" << b.display.getHeight() << "\n";
+    } else {
+        out << framebufferDiff(a.display.getWidth(), a.display.getHeight(),
+                               [&](int x, int y) { return a.display.getPixel(x, y) != 0; },
+                               [&](int x, int y) { return b.display.getPixel(x, y) != 0; }, nameA, nameB);
+    }
+    return out.str();
+}
+
+// One side of a lockstep comparison
+struct Engine {
+    std::string name;
+    std::unique_ptr<Chip8> machine;
+    std::function<void(Chip8 &)> step; // Execute exactly one instruction
+};
+
+// Run two engines instruction by instruction and stop at the first divergence
+bool runLockstep(Engine &a, Engine &b, const ConformConfig &config, const InputMovie &movie) {
+    uint64_t instructions = 0;
+    for (uint32_t frame = 0; frame < config.frames; frame++) {
+        uint16_t keys = movie.keysAt(frame);
+        a.machine->setKeys(keys);
+        b.machine->setKeys(keys);
+
+        for (int n = 0; n < config.instructionsPerFrame; n++) {
+            uint16_t pc = a.machine->getPC();
+            std::string last = a.machine->disassemble(a.machine->decode(a.machine->peek(pc)));
+            a.step(*a.machine);
+            b.step(*b.machine);
+            instructions++;
+            if (config.everyFrame && n + 1 < config.instructionsPerFrame) {
+                continue;
+            }
+            if (n + 1 == config.instructionsPerFrame) {
+                a.machine->updateTimers();
+                b.machine->updateTimers();
+            }
+            std::string diff = stateDiff(*a.machine, *b.machine, a.name, b.name);
+            if (!diff.empty()) {
+                std::cout << "  DIVERGED after instruction " << instructions << " (frame " << frame << "), "
+                          << hex(pc) << ": " << last << "\n" << diff;
+                return false;
+            }
+        }
+    }
+    std::cout << "  conform over " << instructions << " instructions, " << config.frames << " frames\n";
+    return true;
+}
+
+// Single instructions against runFrame(), whose fused idioms can only be compared at frame boundaries
+bool runFrameCheck(Engine &a, Chip8 &fused, const ConformConfig &config, const InputMovie &movie) {
+    for (uint32_t frame = 0; frame < config.frames; frame++) {
+        uint16_t keys = movie.keysAt(frame);
+        a.machine->setKeys(keys);
+        fused.setKeys(keys);
+        for (int n = 0; n < config.instructionsPerFrame; n++) {
+            a.step(*a.machine);
+        }
+        a.machine->updateTimers();
+        fused.runFrame(config.instructionsPerFrame);
+
+        std::string diff = stateDiff(*a.machine, fused, a.name, "runFrame");
+        if (!diff.empty()) {
+            std::cout << "  DIVERGED in frame " << frame << "\n" << diff;
+            return false;
+        }
+    }
+    std::cout << "  conform over " << static_cast<uint64_t>(config.frames) * config.instructionsPerFrame
+              << " instructions, " << config.frames << " frames\n";
+    return true;
+}
+
+// Legacy display: one bool per pixel, drawn the straightforward way, single plane
+class ReferenceDisplay {
+    int width = 64;
+    int height = 32;
+    std::vector<bool> pixels = std::vector<bool>(64 * 32);
+
+    bool draw(const Chip8 &machine, uint8_t vx, uint8_t vy, uint16_t index, int spriteWidth, int spriteHeight) {
+        bool wrap = machine.getQuirks().wrapSprites;
+        int x0 = vx % width;
+        int y0 = vy % height;
+        bool collision = false;
+        for (int row = 0; row < spriteHeight; row++) {
+            int y = y0 + row;
+            if (y >= height) {
+                if (!wrap) {
+                    break;
+                }
+                y -= height;
+            }
+            for (int col = 0; col < spriteWidth; col++) {
+                uint16_t address = static_cast<uint16_t>(index + row * (spriteWidth / 8) + col / 8);
+                if (!(machine.readMemory(address) & (0x80 >> (col % 8)))) {
+                    continue;
+                }
+                int x = x0 + col;
+                if (x >= width) {
+                    if (!wrap) {
+                        continue;
+                    }
+                    x -= width;
+                }
+                collision |= pixels[y * width + x];
+                pixels[y * width + x] = !pixels[y * width + x];
+            }
+        }
+        return collision;
+    }
+
+    void scroll(int dx, int dy) {
+        std::vector<bool> scrolled(pixels.size());
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int fromX = x - dx;
+                int fromY = y - dy;
+                if (fromX >= 0 && fromX < width && fromY >= 0 && fromY < height) {
+                    scrolled[y * width + x] = pixels[fromY * width + fromX];
+                }
+            }
+        }
+        pixels = scrolled;
+    }
+
+public:
+    struct Before {
+        Op op;
+        Instruction i;
+        uint8_t vx, vy;
+        uint16_t index;
+    };
+
+    static Before capture(const Chip8 &machine) {
+        Instruction i = machine.decode(machine.peek(machine.getPC()));
+        return {machine.decodeOp(i), i, machine.getV(i.x), machine.getV(i.y), machine.getIndex()};
+    }
+
+    // Mirror the instruction captured in before; returns the collision flag for draws
+    std::optional<bool> apply(const Before &before, const Chip8 &machine) {
+        switch (before.op) {
+            case Op::Cls:
+                std::fill(pixels.begin(), pixels.end(), false);
+                return std::nullopt;
+            case Op::Draw:
+                return draw(machine, before.vx, before.vy, before.index, 8, before.i.n);
+            case Op::DrawBig:
+                return draw(machine, before.vx, before.vy, before.index, 16, 16);
+            case Op::ScrollDown:
+                scroll(0, before.i.n);
+                return std::nullopt;
+            case Op::ScrollUp:
+                scroll(0, -before.i.n);
+                return std::nullopt;
+            case Op::ScrollRight:
+                scroll(4, 0);
+                return std::nullopt;
+            case Op::ScrollLeft:
+                scroll(-4, 0);
+                return std::nullopt;
+            case Op::LoRes:
+            case Op::HiRes:
+                width = machine.display.getWidth();
+                height = machine.display.getHeight();
+                pixels.assign(width * height, false);
+                return std::nullopt;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    std::string diff(const Chip8 &machine) const {
+        if (machine.display.getWidth() != width || machine.display.getHeight() != height) {
+            return "  display: " + std::to_string(machine.display.getWidth()) + "x" + std::to_string(machine.display.getHeight()) +
+                   " vs " + std::to_string(width) + "x" + std::to_string(height) + "\n";
+        }
+        return framebufferDiff(width, height,
+                               [&](int x, int y) { return (machine.display.getPixel(x, y) & 1) != 0; },
+                               [&](int x, int y) { return pixels[y * width + x]; }, "packed", "reference");
+    }
+};
+
+// Run one machine against the reference display, checking pixels and the collision flag
+bool runDisplayCheck(Chip8 &machine, const ConformConfig &config, const InputMovie &movie) {
+    ReferenceDisplay reference;
+    uint64_t instructions = 0;
+    for (uint32_t frame = 0; frame < config.frames; frame++) {
+        machine.setKeys(movie.keysAt(frame));
+        for (int n = 0; n < config.instructionsPerFrame; n++) {
+            ReferenceDisplay::Before before = ReferenceDisplay::capture(machine);
+            uint16_t pc = machine.getPC();
+            machine.emulateCycle();
+            instructions++;
+            std::optional<bool> collision = reference.apply(before, machine);
+
+            std::string diff;
+            if (collision && machine.getV(0xF) != *collision) {
+                diff = "  VF: " + std::to_string(machine.getV(0xF)) + " (packed) vs " + std::to_string(*collision) + " (reference)\n";
+            }
+            if (!config.everyFrame || n + 1 == config.instructionsPerFrame) {
+                diff += reference.diff(machine);
+            }
+            if (!diff.empty()) {
+                std::cout << "  DIVERGED after instruction " << instructions << " (frame " << frame << "), "
+                          << hex(pc) << ": " << machine.disassemble(before.i) << "\n" << diff;
+                return false;
+            }
+        }
+        machine.updateTimers();
+    }
+    std::cout << "  conform over " << instructions << " instructions, " << config.frames << " frames\n";
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        ConformConfig config = parseCommandLine(argc, argv);
+        std::vector<uint8_t> rom = readROMFile(config.romPath);
+        InputMovie movie = config.moviePath.empty() ? InputMovie() : InputMovie::load(config.moviePath);
+
+        Mode mode = config.chipType ? *config.chipType : detectMode(rom.data(), rom.size());
+
+        auto enabled = [&](const std::string &check) {
+            return config.checks.empty() || std::find(config.checks.begin(), config.checks.end(), check) != config.checks.end();
+        };
+        auto interpret = [](Chip8 &machine) { machine.emulateCycle(); };
+        bool conform = true;
+
+        // The same platform on two cores: CHIP-8 on Chip8 and SuperChip, SUPER-CHIP on SuperChip and XOChip
+        if (enabled("cores")) {
+            std::cout << "cores (" << modeName(mode) << "):\n";
+            if (mode == Mode::XOCHIP) {
+                std::cout << "  skipped, only XOChip runs xochip\n";
+            } else {
+                Engine a{mode == Mode::CHIP8 ? "Chip8" : "SuperChip",
+                         loadMachine(createMachine(mode), rom, mode, config),
+                         interpret};
+                Engine b{mode == Mode::CHIP8 ? "SuperChip" : "XOChip",
+                         loadMachine(createMachine(mode == Mode::CHIP8 ? Mode::SUPERCHIP : Mode::XOCHIP), rom, mode, config),
+                         interpret};
+                conform &= runLockstep(a, b, config, movie);
+            }
+        }
+
+        // The plain interpreter loop against the debugger's checked dispatch loop
+        if (enabled("dispatch")) {
+            std::cout << "dispatch (" << modeName(mode) << "):\n";
+            Debugger debugger;
+            Engine a{"emulateCycle", loadMachine(createMachine(mode), rom, mode, config), interpret};
+            Engine b{"debugger", loadMachine(createMachine(mode), rom, mode, config),
+                     [&debugger](Chip8 &machine) { debugger.run(machine, 1); }};
+            conform &= runLockstep(a, b, config, movie);
+        }
+
+        // One instruction per dispatch against the fused frame loop
+        if (enabled("fusion")) {
+            std::cout << "fusion (" << modeName(mode) << "):\n";
+            Engine a{"emulateCycle", loadMachine(createMachine(mode), rom, mode, config), interpret};
+            std::unique_ptr<Chip8> fused = loadMachine(createMachine(mode), rom, mode, config);
+            conform &= runFrameCheck(a, *fused, config, movie);
+        }
+
+        // Packed bit-plane display against a std::vector<bool> reference
+        if (enabled("display")) {
+            std::cout << "display (" << modeName(mode) << "):\n";
+            if (mode == Mode::XOCHIP) {
+                std::cout << "  skipped, the reference display has a single plane\n";
+            } else {
+                std::unique_ptr<Chip8> machine = loadMachine(createMachine(mode), rom, mode, config);
+                conform &= runDisplayCheck(*machine, config, movie);
+            }
+        }
+
+        return conform ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,549 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "Debugger.h"
+#include "MachineArena.h"
+#include "RomLoader.h"
+#include "ThreadPool.h"
+
+/*
+ * State-space explorer for automated playthroughs and ROM verification.
+ * Starting from the loaded ROM, every search step holds one keypad action for a few frames.
+ * The search is level by level: all children of the frontier are expanded in parallel,
+ * deduplicated exactly against every state seen so far by their state key (registers plus
+ * the memory and display words that differ from the root), and the next frontier is either
+ * all new states (breadth-first, shortest input sequences first) or the best-scoring ones
+ * (beam). Reaching a target prints the input sequence as an input movie
+ * that chip8conform and the emulator can replay.
+ */
+
+struct ExploreConfig {
+    std::string romPath;
+    std::optional<Mode> chipType; // Empty: detect from the ROM
+    bool beam = false; // Beam search instead of breadth-first
+    size_t width = 256; // Beam width
+    size_t maxFrontier = 4096; // Breadth-first frontier limit, larger levels are truncated
+    uint32_t depth = 600; // Steps to search
+    int frameskip = 4; // Frames each action is held
+    int instructionsPerFrame = 8;
+    std::vector<uint16_t> actions; // Key masks tried at every step
+    std::optional<uint16_t> scoreAddress; // Beam ranking: memory byte, higher first
+    std::vector<std::string> targets; // Target conditions as given on the command line
+    std::string moviePath; // Input movie of the first target reached
+    uint32_t seed = 1;
+    size_t threads = 0; // 0: one per core
+    bool verbose = false; // One line per level
+};
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options] <rom_path>\n"
+              << "Options:\n"
+              << "  --chip <type>         Chip type (auto, chip8, schip10, schip11, superchip or xochip) [default: auto]\n"
+              << "  --beam <width>        Beam search keeping the best <width> states per step [default: breadth-first]\n"
+              << "  --score <addr>        Beam ranking: memory byte at addr, higher first [default: state hash]\n"
+              << "  --max-frontier <n>    Breadth-first states kept per step, more are truncated [default: 4096]\n"
+              << "  --depth <n>           Steps to search [default: 600]\n"
+              << "  --frameskip <n>       Frames each action is held [default: 4]\n"
+              << "  --ipf <n>             Instructions per frame [default: 8]\n"
+              << "  --keys <hex digits>   Keys to try one at a time, besides no key [default: 0123456789ABCDEF]\n"
+              << "  --pc <addr>           Target: PC reaches addr (repeatable, all targets are searched for)\n"
+              << "  --mem <addr>=<value>  Target: memory byte at addr equals value\n"
+              << "  --reg <condition>     Target: register condition, e.g. V3==0x10 or I>=0x300\n"
+              << "  --pattern <x>,<y>,<file>  Target: pixels at (x, y) match a file of '#' and '.' rows\n"
+              << "  --halt                Target: the program exits (00FD)\n"
+              << "  --movie <path>        Write the input movie of the first target reached\n"
+              << "  --seed <n>            Seed for CXNN [default: 1]\n"
+              << "  --threads <n>         Worker threads including the main one [default: one per core]\n"
+              << "  --verbose             Print every step\n"
+              << "  --help                Show this help message\n";
+}
+
+int positive(const char *text, const char *what) {
+    int value = std::stoi(text);
+    if (value < 1) {
+        throw std::runtime_error(std::string(what) + " must be positive");
+    }
+    return value;
+}
+
+ExploreConfig parseCommandLine(int argc, char* argv[]) {
+    ExploreConfig config;
+    std::string keys = "0123456789ABCDEF";
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+        if (arg == "--help") {
+            printUsage(argv[0]);
+            std::exit(0);
+        } else if (arg == "--chip" && i + 1 < argc) {
+            config.chipType = parseMode(argv[++i]);
+        } else if (arg == "--beam" && i + 1 < argc) {
+            config.beam = true;
+            config.width = positive(argv[++i], "Beam width");
+        } else if (arg == "--score" && i + 1 < argc) {
+            config.scoreAddress = static_cast<uint16_t>(std::stoul(argv[++i], nullptr, 0));
+        } else if (arg == "--max-frontier" && i + 1 < argc) {
+            config.maxFrontier = positive(argv[++i], "Frontier limit");
+        } else if (arg == "--depth" && i + 1 < argc) {
+            config.depth = positive(argv[++i], "Depth");
+        } else if (arg == "--frameskip" && i + 1 < argc) {
+            config.frameskip = positive(argv[++i], "Frameskip");
+        } else if (arg == "--ipf" && i + 1 < argc) {
+            config.instructionsPerFrame = positive(argv[++i], "Instructions per frame");
+        } else if (arg == "--keys" && i + 1 < argc) {
+            keys = argv[++i];
+        } else if ((arg == "--pc" || arg == "--mem" || arg == "--reg" || arg == "--pattern") && i + 1 < argc) {
+            config.targets.push_back(std::string(arg.substr(2)) + " " + argv[++i]);
+        } else if (arg == "--halt") {
+            config.targets.emplace_back("halt");
+        } else if (arg == "--movie" && i + 1 < argc) {
+            config.moviePath = argv[++i];
+        } else if (arg == "--seed" && i + 1 < argc) {
+            config.seed = static_cast<uint32_t>(std::stoul(argv[++i], nullptr, 0));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            config.threads = positive(argv[++i], "Thread count");
+        } else if (arg == "--verbose") {
+            config.verbose = true;
+        } else if (config.romPath.empty()) {
+            config.romPath = arg;
+        } else {
+            throw std::runtime_error("Unexpected argument: " + std::string(arg));
+        }
+    }
+    if (config.romPath.empty()) {
+        printUsage(argv[0]);
+        throw std::runtime_error("ROM path is required");
+    }
+
+    config.actions.push_back(0);
+    for (char key : keys) {
+        if (!std::isxdigit(static_cast<unsigned char>(key))) {
+            throw std::runtime_error("Invalid key: " + std::string(1, key));
+        }
+        uint16_t mask = static_cast<uint16_t>(1 << std::stoi(std::string(1, key), nullptr, 16));
+        if (std::find(config.actions.begin(), config.actions.end(), mask) == config.actions.end()) {
+            config.actions.push_back(mask);
+        }
+    }
+    return config;
+}
+
+// Condition a search looks for; PC targets are checked before every instruction, the rest after every step
+struct Target {
+    enum class Kind { PC, Memory, Register, Pattern, Halt };
+
+    Kind kind;
+    std::string description;
+    uint16_t address = 0; // PC, memory address
+    uint8_t value = 0; // Memory value
+    std::optional<RegisterCondition> condition;
+    int x = 0; // Pattern origin
+    int y = 0;
+    std::vector<std::string> rows; // Pattern rows, '#' lit and anything else dark
+
+    static Target parse(const std::string &text) {
+        Target target;
+        target.description = text;
+        std::string kind = text.substr(0, text.find(' '));
+        std::string argument = text.substr(std::min(text.size(), kind.size() + 1));
+        if (kind == "pc") {
+            target.kind = Kind::PC;
+            target.address = static_cast<uint16_t>(std::stoul(argument, nullptr, 0));
+        } else if (kind == "mem") {
+            size_t equals = argument.find('=');
+            if (equals == std::string::npos) {
+                throw std::runtime_error("Invalid memory target (expected addr=value): " + argument);
+            }
+            target.kind = Kind::Memory;
+            target.address = static_cast<uint16_t>(std::stoul(argument.substr(0, equals), nullptr, 0));
+            target.value = static_cast<uint8_t>(std::stoul(argument.substr(equals + 1), nullptr, 0));
+        } else if (kind == "reg") {
+            target.kind = Kind::Register;
+            target.condition = RegisterCondition::parse(argument);
+        } else if (kind == "pattern") {
+            std::stringstream fields(argument);
+            std::string x, y, path;
+            if (!std::getline(fields, x, ',') || !std::getline(fields, y, ',') || !std::getline(fields, path)) {
+                throw std::runtime_error("Invalid pattern target (expected x,y,file): " + argument);
+            }
+            target.kind = Kind::Pattern;
+            target.x = std::stoi(x);
+            target.y = std::stoi(y);
+            std::ifstream file(path);
+            if (!file) {
+                throw std::runtime_error("Unable to open pattern: " + path);
+            }
+            for (std::string row; std::getline(file, row);) {
+                target.rows.push_back(row);
+            }
+        } else {
+            target.kind = Kind::Halt;
+        }
+        return target;
+    }
+
+    bool matches(const Chip8 &machine) const {
+        switch (kind) {
+            case Kind::PC:
+                return machine.getPC() == address;
+            case Kind::Memory:
+                return machine.readMemory(address) == value;
+            case Kind::Register:
+                return condition->evaluate(machine);
+            case Kind::Halt:
+                return machine.isHalted();
+            case Kind::Pattern:
+                for (size_t row = 0; row < rows.size(); row++) {
+                    for (size_t col = 0; col < rows[row].size(); col++) {
+                        int px = x + static_cast<int>(col);
+                        int py = y + static_cast<int>(row);
+                        if (px >= machine.display.getWidth() || py >= machine.display.getHeight()) {
+                            return false;
+                        }
+                        if ((machine.display.getPixel(px, py) != 0) != (rows[row][col] == '#')) {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+        }
+        return false;
+    }
+};
+
+class Explorer {
+    // Frontier state: where it came from, indices into the previous level and the actions
+    struct Node {
+        uint32_t parent;
+        uint16_t action;
+    };
+    // Reached state: Chip8::stateKey() against the root, looked up by Chip8::stateHash()
+    struct Seen {
+        uint64_t hash;
+        std::string key;
+        bool operator==(const Seen &other) const { return key == other.key; }
+    };
+    struct SeenHash {
+        size_t operator()(const Seen &seen) const { return static_cast<size_t>(seen.hash); }
+    };
+    // One expansion in the current batch of parents, at (parent - first) * actions + action
+    struct Child {
+        Seen state;
+        uint32_t reached; // Bit t: target t was met during the step
+        uint8_t score;
+        bool valid; // False when the parent had halted
+    };
+    // New state stored in the level being built
+    struct Kept {
+        uint32_t child; // parent * actions + action
+        uint64_t hash;
+        uint8_t score;
+    };
+    struct Found {
+        uint32_t depth; // Steps to reach the target
+        uint32_t parent; // Node in level depth - 1
+        uint16_t action;
+    };
+
+    const ExploreConfig &config;
+    std::vector<Target> targets;
+    std::vector<std::pair<uint16_t, uint32_t>> pcTargets; // (address, target bit)
+    uint32_t endTargets = 0; // Bits of targets checked after the step
+    ThreadPool pool;
+
+    std::unique_ptr<Chip8> root;
+    std::unique_ptr<MachineArena> frontier; // Machines of the current level
+    std::unique_ptr<MachineArena> next; // New children of the level being built, copied as expanded
+    std::unique_ptr<MachineArena> expanded; // Children of one batch of parents
+    size_t frontierSize = 1;
+    std::vector<std::vector<Node>> levels; // levels[d]: frontier after d steps
+    std::unordered_set<Seen, SeenHash> seen; // Every state reached
+    std::vector<Child> children;
+    std::vector<Kept> kept; // Machines in next, in order
+    std::vector<uint32_t> copies; // Slots in expanded of the batch's new states
+    std::vector<std::optional<Found>> found; // Per target
+    uint32_t reachedMask = 0;
+    uint64_t expansions = 0;
+    bool truncated = false; // Some breadth-first level exceeded the frontier limit
+
+    uint32_t advance(Chip8 &machine, uint16_t keys) const; // One step, returns the targets met
+    void ensureCapacity(std::unique_ptr<MachineArena> &arena, size_t count, size_t limit); // Discards the contents
+    std::vector<uint16_t> path(const Found &found) const; // Actions from the root
+
+public:
+    Explorer(const ExploreConfig &config, std::unique_ptr<Chip8> machine);
+
+    void run(std::ostream &out);
+    int report(std::ostream &out) const; // Print the results, returns the exit code
+};
+
+Explorer::Explorer(const ExploreConfig &config, std::unique_ptr<Chip8> machine)
+    : config(config), pool(config.threads), root(std::move(machine)) {
+    if (config.targets.size() > 32) {
+        throw std::runtime_error("At most 32 targets");
+    }
+    for (const std::string &text : config.targets) {
+        targets.push_back(Target::parse(text));
+        uint32_t bit = 1u << (targets.size() - 1);
+        if (targets.back().kind == Target::Kind::PC) {
+            pcTargets.emplace_back(targets.back().address, bit);
+        } else {
+            endTargets |= bit;
+        }
+    }
+    found.resize(targets.size());
+    frontier = std::make_unique<MachineArena>(*root, 1);
+    levels.push_back({Node{0, 0}});
+    seen.insert(Seen{root->stateHash(), root->stateKey(*root)});
+}
+
+uint32_t Explorer::advance(Chip8 &machine, uint16_t keys) const {
+    machine.setKeys(keys);
+    uint32_t reached = 0;
+    auto checkPC = [&] {
+        for (const auto &[address, bit] : pcTargets) {
+            if (machine.getPC() == address) {
+                reached |= bit;
+            }
+        }
+    };
+    for (int frame = 0; frame < config.frameskip; frame++) {
+        if (pcTargets.empty()) {
+            machine.runFrame(config.instructionsPerFrame);
+            continue;
+        }
+        // PC targets need every instruction boundary, so no fused idioms here
+        for (int n = 0; n < config.instructionsPerFrame; n++) {
+            checkPC();
+            machine.emulateCycle();
+        }
+        machine.updateTimers(); // Only moves the clock if the frame halted early
+    }
+    checkPC();
+    for (size_t t = 0; t < targets.size(); t++) {
+        if ((endTargets >> t & 1) && targets[t].matches(machine)) {
+            reached |= 1u << t;
+        }
+    }
+    return reached;
+}
+
+void Explorer::ensureCapacity(std::unique_ptr<MachineArena> &arena, size_t count, size_t limit) {
+    if (!arena || arena->size() < count) {
+        size_t size = std::min(std::max(count, arena ? arena->size() * 2 : 1), limit);
+        arena.reset(); // Release before allocating the larger one
+        arena = std::make_unique<MachineArena>(*root, size);
+    }
+}
+
+void Explorer::run(std::ostream &out) {
+    const size_t actionCount = config.actions.size();
+    const size_t chunk = 8; // Parents per task
+    const size_t batch = std::max<size_t>(1, (32 << 20) / root->objectSize() / actionCount); // Parents per 32 MB of children
+    const size_t keepLimit = config.beam ? config.width * actionCount : config.maxFrontier;
+    const uint32_t allTargets = targets.size() == 32 ? ~0u : (1u << targets.size()) - 1;
+
+    for (uint32_t depth = 0; depth < config.depth && frontierSize > 0; depth++) {
+        if (!targets.empty() && reachedMask == allTargets) {
+            break;
+        }
+
+        ensureCapacity(expanded, std::min(frontierSize, batch) * actionCount, batch * actionCount);
+        ensureCapacity(next, std::min(frontierSize * actionCount, keepLimit), keepLimit);
+        kept.clear();
+        size_t newStates = 0;
+        for (size_t first = 0; first < frontierSize; first += batch) {
+            const size_t last = std::min(frontierSize, first + batch);
+
+            // Expand every parent of the batch with every action
+            children.resize((last - first) * actionCount);
+            pool.parallelFor((last - first + chunk - 1) / chunk, [&](size_t task) {
+                size_t end = std::min(last, first + (task + 1) * chunk);
+                for (size_t parent = first + task * chunk; parent < end; parent++) {
+                    const Chip8 &state = (*frontier)[parent];
+                    for (size_t action = 0; action < actionCount; action++) {
+                        size_t slot = (parent - first) * actionCount + action;
+                        Child &child = children[slot];
+                        child.valid = !state.isHalted(); // Halted machines ignore input
+                        if (!child.valid) {
+                            continue;
+                        }
+                        Chip8 &machine = (*expanded)[slot];
+                        machine.restore(state);
+                        child.reached = advance(machine, config.actions[action]);
+                        child.state.hash = machine.stateHash();
+                        child.state.key = machine.stateKey(*root);
+                        child.score = config.scoreAddress ? machine.readMemory(*config.scoreAddress) : 0;
+                    }
+                }
+            });
+            expansions += children.size();
+
+            // Record targets and keep new states, in order so results do not depend on scheduling
+            const size_t batchStart = kept.size();
+            copies.clear();
+            for (size_t slot = 0; slot < children.size(); slot++) {
+                Child &child = children[slot];
+                if (!child.valid) {
+                    continue;
+                }
+                const uint32_t i = static_cast<uint32_t>(first * actionCount + slot);
+                for (uint32_t pending = child.reached & ~reachedMask; pending; pending &= pending - 1) {
+                    int t = std::countr_zero(pending);
+                    found[t] = Found{depth + 1, static_cast<uint32_t>(i / actionCount), static_cast<uint16_t>(i % actionCount)};
+                }
+                reachedMask |= child.reached;
+                if (!seen.insert(std::move(child.state)).second) {
+                    continue;
+                }
+                newStates++;
+                if (kept.size() == keepLimit) {
+                    truncated = true; // Breadth-first only, a beam level fits every child
+                    continue;
+                }
+                copies.push_back(static_cast<uint32_t>(slot));
+                kept.push_back(Kept{i, child.state.hash, child.score});
+            }
+            pool.parallelFor(copies.size(), [&](size_t n) {
+                (*next)[batchStart + n].restore((*expanded)[copies[n]]);
+            });
+        }
+
+        // Beam: the best states move to the front of the level, keeping their order
+        if (config.beam && kept.size() > config.width) {
+            std::vector<uint32_t> best(kept.size());
+            std::iota(best.begin(), best.end(), 0);
+            std::partial_sort(best.begin(), best.begin() + config.width, best.end(), [&](uint32_t a, uint32_t b) {
+                const Kept &x = kept[a], &y = kept[b];
+                return x.score != y.score ? x.score > y.score : x.hash < y.hash;
+            });
+            best.resize(config.width);
+            std::sort(best.begin(), best.end());
+            for (size_t n = 0; n < best.size(); n++) {
+                if (best[n] != n) { // best[n] > n, not yet overwritten
+                    (*next)[n].restore((*next)[best[n]]);
+                    kept[n] = kept[best[n]];
+                }
+            }
+            kept.resize(config.width);
+        }
+
+        std::vector<Node> level(kept.size());
+        for (size_t n = 0; n < kept.size(); n++) {
+            level[n] = Node{static_cast<uint32_t>(kept[n].child / actionCount), static_cast<uint16_t>(kept[n].child % actionCount)};
+        }
+        std::swap(frontier, next);
+        frontierSize = kept.size();
+        levels.push_back(std::move(level));
+
+        if (config.verbose) {
+            out << "step " << depth + 1 << ": " << newStates << " new states, " << frontierSize
+                      << " kept, " << seen.size() << " seen\n";
+        }
+    }
+}
+
+std::vector<uint16_t> Explorer::path(const Found &found) const {
+    std::vector<uint16_t> actions{config.actions[found.action]};
+    uint32_t node = found.parent;
+    for (uint32_t depth = found.depth - 1; depth > 0; depth--) {
+        const Node &step = levels[depth][node];
+        actions.push_back(config.actions[step.action]);
+        node = step.parent;
+    }
+    std::reverse(actions.begin(), actions.end());
+    return actions;
+}
+
+int Explorer::report(std::ostream &out) const {
+    out << "explored " << seen.size() << " states in " << levels.size() - 1 << " steps, "
+              << expansions << " expansions";
+    if (truncated) {
+        out << " (frontier truncated at " << config.maxFrontier << " states)";
+    }
+    out << "\n";
+
+    bool first = true;
+    for (size_t t = 0; t < targets.size(); t++) {
+        if (!found[t]) {
+            out << "not reached: " << targets[t].description << "\n";
+            continue;
+        }
+        std::vector<uint16_t> actions = path(*found[t]);
+        std::stringstream movie;
+        for (size_t step = 0; step < actions.size(); step++) {
+            if (step == 0 || actions[step] != actions[step - 1]) {
+                movie << step * config.frameskip << " " << std::hex << std::uppercase << std::setfill('0')
+                      << std::setw(4) << actions[step] << std::dec << "\n";
+            }
+        }
+        out << "reached: " << targets[t].description << " after " << actions.size() << " steps ("
+                  << actions.size() * config.frameskip << " frames)\n";
+        std::string line;
+        for (std::istringstream lines(movie.str()); std::getline(lines, line);) {
+            out << "  " << line << "\n";
+        }
+        if (first && !config.moviePath.empty()) {
+            std::ofstream file(config.moviePath);
+            if (!file) {
+                throw std::runtime_error("Unable to write input movie: " + config.moviePath);
+            }
+            file << "# " << targets[t].description << "\n" << movie.str();
+            first = false;
+        }
+    }
+    return reachedMask == (targets.size() == 32 ? ~0u : (1u << targets.size()) - 1) ? 0 : 1;
+}
+
+// Stream buffer that drops everything written to it
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+int main(int argc, char* argv[]) {
+    try {
+        ExploreConfig config = parseCommandLine(argc, argv);
+        std::vector<uint8_t> rom = readROMFile(config.romPath);
+
+        Mode mode = config.chipType ? *config.chipType : detectMode(rom.data(), rom.size());
+        std::unique_ptr<Chip8> machine = createMachine(mode);
+        machine->loadROM(rom.data(), rom.size());
+        machine->setSeed(config.seed);
+        machine->setCyclesPerSecond(config.instructionsPerFrame * 60); // A frame is one timer tick
+
+        // Core diagnostics ("Unknown instruction") would flood the report
+        std::ostream out(std::cout.rdbuf());
+        NullBuffer discard;
+        std::cout.rdbuf(&discard);
+
+        Explorer explorer(config, std::move(machine));
+        auto start = std::chrono::steady_clock::now();
+        explorer.run(out);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        int status = explorer.report(out);
+        out << std::fixed << std::setprecision(2) << seconds << " s\n";
+        std::cout.rdbuf(out.rdbuf());
+        return status;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
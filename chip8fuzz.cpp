@@ -0,0 +1,105 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "Analyzer.h"
+#include "RomLoader.h"
+
+/*
+ * Fuzzing entry point for the headless core.
+ * Built with -DCHIP8_LIBFUZZER it is a libFuzzer target (AFL++ drives the same symbol
+ * through its libFuzzer driver); otherwise main() runs each file given on the command
+ * line, or stdin, which serves AFL++ file mode and replaying crashes.
+ *
+ * Input layout:
+ *   byte 0      mode (low 3 bits, modulo the number of modes); bit 7 also runs the analyzer
+ *   byte 1      length L of the input movie
+ *   L bytes     one keypad event per frame: bit 7 pressed, low nibble key
+ *   rest        ROM image loaded at 0x200
+ */
+
+namespace {
+
+constexpr Mode MODES[] = {Mode::CHIP8, Mode::SCHIP10, Mode::SCHIP11, Mode::SUPERCHIP, Mode::XOCHIP};
+constexpr int FRAMES = 60;
+constexpr int INSTRUCTIONS_PER_FRAME = 32;
+
+void runInput(const uint8_t *data, size_t size) {
+    if (size < 2) {
+        return;
+    }
+    Mode mode = MODES[(data[0] & 0x7) % std::size(MODES)];
+    bool analyze = data[0] & 0x80;
+    size_t movieLength = std::min<size_t>(data[1], size - 2);
+    const uint8_t *movie = data + 2;
+    const uint8_t *rom = movie + movieLength;
+    size_t romSize = size - 2 - movieLength;
+
+    std::unique_ptr<Chip8> machine = createMachine(mode);
+    try {
+        machine->loadROM(rom, romSize);
+    } catch (const std::runtime_error &) {
+        return; // Too large for the platform
+    }
+    machine->setSeed(1);
+    machine->setCyclesPerSecond(INSTRUCTIONS_PER_FRAME * 60);
+
+    for (int frame = 0; frame < FRAMES && !machine->isHalted(); frame++) {
+        if (frame < static_cast<int>(movieLength)) {
+            machine->keypad[movie[frame] & 0xF] = movie[frame] & 0x80;
+        }
+        machine->runFrame(INSTRUCTIONS_PER_FRAME);
+    }
+    if (machine->getPC() >= machine->memorySize()) {
+        std::abort(); // Program counter escaped the address space
+    }
+
+    if (analyze) {
+        analyzeROM(rom, romSize, mode);
+    }
+}
+
+// Core diagnostics ("Unknown instruction") would dominate the run time
+void silenceOutput() {
+    static std::ostringstream sink;
+    std::cout.rdbuf(sink.rdbuf());
+    sink.str("");
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    silenceOutput();
+    runInput(data, size);
+    return 0;
+}
+
+#ifndef CHIP8_LIBFUZZER
+int main(int argc, char* argv[]) {
+    std::vector<std::vector<uint8_t>> inputs;
+    if (argc < 2) {
+        inputs.emplace_back(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    }
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: Unable to open " << argv[i] << std::endl;
+            return 1;
+        }
+        inputs.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    for (const std::vector<uint8_t> &input : inputs) {
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    return 0;
+}
+#endif
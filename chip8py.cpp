@@ -0,0 +1,150 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include "RomLoader.h"
+#include "VectorEnv.h"
+
+namespace py = pybind11;
+
+namespace {
+
+// ROM bytes, or a path to a ROM file
+std::vector<uint8_t> romFromPython(const py::object &rom) {
+    if (py::isinstance<py::bytes>(rom) || py::isinstance<py::bytearray>(rom)) {
+        std::string data = rom.cast<std::string>();
+        return std::vector<uint8_t>(data.begin(), data.end());
+    }
+    return readROMFile(rom.cast<std::string>());
+}
+
+Mode modeForROM(const std::vector<uint8_t> &rom, const std::string &chip) {
+    if (std::optional<Mode> forced = parseMode(chip)) {
+        return *forced;
+    }
+    return detectMode(rom.data(), rom.size());
+}
+
+// Read-only array over memory owned by the environment, kept alive through base
+template <typename T>
+py::array readOnlyView(std::vector<py::ssize_t> shape, std::vector<py::ssize_t> strides, const T *data, py::handle base) {
+    py::array_t<T> view(std::move(shape), std::move(strides), data, base);
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
+
+py::array observations(py::object self) {
+    const VectorEnv &env = self.cast<const VectorEnv &>();
+    const Display &display = env.machine(0).display;
+    return readOnlyView<uint64_t>(
+        {static_cast<py::ssize_t>(env.size()), Display::PLANES, Display::MAX_HEIGHT, Display::WORDS},
+        {static_cast<py::ssize_t>(env.stride()), sizeof(display.planes[0]), sizeof(display.planes[0][0]), sizeof(uint64_t)},
+        &display.planes[0][0][0], self);
+}
+
+}
+
+PYBIND11_MODULE(chip8, m) {
+    m.doc() = "Headless CHIP-8/SUPER-CHIP/XO-CHIP cores as a vectorized environment";
+
+    py::enum_<Mode>(m, "Mode")
+        .value("CHIP8", Mode::CHIP8)
+        .value("SCHIP10", Mode::SCHIP10)
+        .value("SCHIP11", Mode::SCHIP11)
+        .value("SUPERCHIP", Mode::SUPERCHIP)
+        .value("XOCHIP", Mode::XOCHIP);
+
+    // Opaque machine state from VectorEnv.snapshot()
+    py::class_<Chip8, std::unique_ptr<Chip8>>(m, "Snapshot")
+        .def_property_readonly("pc", &Chip8::getPC)
+        .def_property_readonly("mode", &Chip8::getMode);
+
+    py::class_<VectorEnv>(m, "VectorEnv", R"doc(
+N machines running the same ROM.
+
+Observations are zero-copy, read-only views of the packed framebuffers with shape
+(N, planes, 64, 2) and dtype uint64: each row is 128 pixels in two words, leftmost
+pixel in the most significant bit. Only the top-left width x height pixels are in use.
+Actions are one uint16 key mask per instance, bit n holding key n down for the step.
+Instances that halt (00FD) report done and restart from the ROM.
+)doc")
+        .def(py::init([](const py::object &rom, size_t numEnvs, const std::string &chip, int frameskip,
+                         int instructionsPerFrame, size_t threads) {
+                 std::vector<uint8_t> data = romFromPython(rom);
+                 return std::make_unique<VectorEnv>(data, modeForROM(data, chip), numEnvs, frameskip,
+                                                    instructionsPerFrame, threads);
+             }),
+             py::arg("rom"), py::arg("num_envs"), py::arg("chip") = "auto", py::arg("frameskip") = 4,
+             py::arg("instructions_per_frame") = 8, py::arg("threads") = 0)
+        .def("__len__", &VectorEnv::size)
+        .def_property_readonly("mode", &VectorEnv::getMode)
+        .def_property_readonly("observations", &observations)
+        .def_property_readonly("ram", [](py::object self) {
+            const VectorEnv &env = self.cast<const VectorEnv &>();
+            return readOnlyView<uint8_t>(
+                {static_cast<py::ssize_t>(env.size()), static_cast<py::ssize_t>(env.machine(0).memorySize())},
+                {static_cast<py::ssize_t>(env.stride()), 1}, env.machine(0).getMemory(), self);
+        }, "Zero-copy, read-only view of every instance's memory, shape (N, memory size)")
+        .def("reset", [](py::object self, uint32_t seed) {
+            {
+                py::gil_scoped_release release;
+                self.cast<VectorEnv &>().reset(seed);
+            }
+            return observations(self);
+        }, py::arg("seed") = 0, "Restart every instance; instance i seeds its CXNN generator with seed + i")
+        .def("step", [](py::object self, py::array_t<uint16_t, py::array::c_style | py::array::forcecast> actions) {
+            VectorEnv &env = self.cast<VectorEnv &>();
+            if (actions.ndim() != 1 || static_cast<size_t>(actions.shape(0)) != env.size()) {
+                throw py::value_error("step() expects one key mask per instance");
+            }
+            std::vector<uint16_t> masks(actions.data(), actions.data() + env.size());
+            {
+                py::gil_scoped_release release;
+                env.step(masks.data());
+            }
+            py::array_t<bool> done(static_cast<py::ssize_t>(env.size()));
+            for (size_t i = 0; i < env.size(); i++) {
+                done.mutable_at(i) = env.getDone()[i];
+            }
+            return py::make_tuple(observations(self), done);
+        }, py::arg("actions"), "Run frameskip frames on every instance, returns (observations, done)")
+        .def("resolutions", [](const VectorEnv &env) {
+            py::array_t<int32_t> sizes({static_cast<py::ssize_t>(env.size()), static_cast<py::ssize_t>(2)});
+            for (size_t i = 0; i < env.size(); i++) {
+                sizes.mutable_at(i, 0) = env.machine(i).display.getWidth();
+                sizes.mutable_at(i, 1) = env.machine(i).display.getHeight();
+            }
+            return sizes;
+        }, "(width, height) of every instance's display")
+        .def("screens", [](const VectorEnv &env) {
+            py::array_t<uint8_t> screens({static_cast<py::ssize_t>(env.size()),
+                                          static_cast<py::ssize_t>(Display::MAX_HEIGHT),
+                                          static_cast<py::ssize_t>(Display::MAX_WIDTH)});
+            uint8_t *out = screens.mutable_data();
+            {
+                py::gil_scoped_release release;
+                for (size_t i = 0; i < env.size(); i++) {
+                    const Display &display = env.machine(i).display;
+                    for (int y = 0; y < Display::MAX_HEIGHT; y++) {
+                        for (int x = 0; x < Display::MAX_WIDTH; x++) {
+                            *out++ = display.getPixel(x, y);
+                        }
+                    }
+                }
+            }
+            return screens;
+        }, "Unpacked copy of every framebuffer, shape (N, 64, 128), values are plane bits")
+        .def("enable_cache", &VectorEnv::enableCache, py::arg("capacity"), py::arg("verify") = false,
+             "Memoize steps by (state hash, action), keeping up to capacity snapshots; 0 disables. "
+             "verify compares the whole machine state on every hit")
+        .def("cache_stats", [](const VectorEnv &env) {
+            const FrameCache *cache = env.getCache();
+            return py::make_tuple(cache ? cache->getHits() : 0, cache ? cache->getMisses() : 0,
+                                  cache ? cache->getCollisions() : 0);
+        }, "(hits, misses, collisions) of the step cache")
+        .def("snapshot", &VectorEnv::snapshot, py::arg("index"))
+        .def("restore", &VectorEnv::restore, py::arg("index"), py::arg("snapshot"));
+}
@@ -1,29 +1,131 @@
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <cctype>
+#include <cmath>
 #include <memory>
 #include <string_view>
 #include "Chip8.h"
-#include "SuperChip.h"
 #include <SDL2/SDL.h>
-#include <SDL_ttf.h>
 #include <map>
 #include <filesystem>
+#include <optional>
+#include <random>
 #include <stdexcept>
+#include <thread>
+#include "Debugger.h"
+#include "FrameRecorder.h"
 #include "DisassemblyWindow.h"
+#include "Profiler.h"
+#include "RomLoader.h"
+#include "Scaler.h"
+#include "ThreadPool.h"
+#ifdef CHIP8_GDB_STUB
+#include "GdbStub.h"
+#endif
+#ifdef CHIP8_SHARED_MEMORY
+#include "SharedMemory.h"
+#endif
+#ifdef CHIP8_NETPLAY
+#include "NetPlay.h"
+#endif
+#ifdef CHIP8_TERMINAL
+#include "TerminalView.h"
+#endif
+#ifdef CHIP8_ROM_WATCH
+#include "RomWatcher.h"
+#endif
 
 struct EmulatorConfig {
     std::string romPath;
-    Mode chipType = Mode::CHIP8;
+    bool wall = false; // Tile many machines in one window
+    std::vector<std::string> wallRoms; // ROMs or directories after the first
+    std::optional<Mode> chipType; // Empty: detect from the ROM
     int scale = 15;
+    ScaleFilter filter = ScaleFilter::Nearest;
+    int phosphor = 0; // Percent of brightness kept per frame, 0: off
     bool enableDisassembler = false;
+    std::vector<uint16_t> breakpoints;
+    std::vector<Watchpoint> watchpoints;
+    std::vector<RegisterCondition> conditions;
+    int gdbPort = 0; // 0: no GDB stub
+    std::string sharedMemory; // POSIX shared-memory segment name, empty: none
+    int netplayPort = 0; // Local UDP port, 0: no netplay
+    std::string netplayPeer; // host:port of the other player
+    int player = 1;
+    bool headless = false;
+    bool tty = false; // Headless, drawn in the terminal
+    bool ttyQuarter = false; // Quarter instead of half blocks
+    int frames = 0; // Headless run length, 0: until interrupted
+    bool profile = false;
+    std::optional<uint32_t> seed; // Empty: random
+    std::string recordPath; // Y4M video, empty: none
+    int screenshotEvery = 0; // 0: no screenshots
+    std::string screenshotPrefix; // Empty: ROM file name without extension
+    int recordScale = 4;
+    bool uncapped = false; // Headless frames as fast as possible instead of 60 Hz
+    bool watch = false; // Reload the ROM when its file is rewritten
 };
 
+// Parse "addr" or "addr:length" (decimal or 0x-prefixed hex)
+Watchpoint parseWatchpoint(const std::string &text, bool read, bool write) {
+    size_t colon = text.find(':');
+    uint16_t address = static_cast<uint16_t>(std::stoul(text.substr(0, colon), nullptr, 0));
+    uint16_t length = colon == std::string::npos ? 1 : static_cast<uint16_t>(std::stoul(text.substr(colon + 1), nullptr, 0));
+    return {address, length, read, write};
+}
+
+void printRegisters(const Chip8 &chip8) {
+    std::cout << std::hex << std::uppercase;
+    for (int r = 0; r < 16; r++) {
+        std::cout << "V" << r << "=" << +chip8.getV(r) << (r % 8 == 7 ? "\n" : " ");
+    }
+    std::cout << "PC=" << chip8.getPC() << " I=" << chip8.getIndex() << " SP=" << +chip8.getSP()
+              << " DT=" << +chip8.getDelayTimer() << " ST=" << +chip8.getSoundTimer() << "\n"
+              << "next: " << chip8.disassemble(chip8.decode(chip8.peek(chip8.getPC()))) << std::dec << std::endl;
+}
+
 void printUsage(const char* programName) {
     std::cout << "Usage: " << programName << " [options] <rom_path>\n"
+              << "       " << programName << " --wall [options] <rom_or_directory>...\n"
               << "Options:\n"
-              << "  --chip <type>    Chip type (chip8 or superchip) [default: chip8]\n"
+              << "  --chip <type>    Chip type (auto, chip8, schip10, schip11, superchip or xochip) [default: auto]\n"
               << "  --scale <n>      Display scale factor [default: 15]\n"
+              << "  --filter <name>  Upscaling filter: nearest, epx (scale2x) or scale3x [default: nearest]\n"
+              << "  --phosphor <pct> Phosphor persistence, percent of brightness kept per frame [default: 0]\n"
               << "  --disasm         Enable instruction disassembly output [default: false]\n"
+              << "  --wall           Run every ROM given (directories: every ROM inside) tiled in one window\n"
+              << "  --break <addr>   Pause when PC reaches addr (repeatable)\n"
+              << "  --watch-read <addr[:len]>   Pause before an instruction reads memory in range\n"
+              << "  --watch-write <addr[:len]>  Pause before an instruction writes memory in range\n"
+              << "  --break-if <cond>  Pause when a register condition becomes true, e.g. V3==0x10 or I>=0x300\n"
+#ifdef CHIP8_GDB_STUB
+              << "  --gdb-port <port>  Accept a GDB remote connection on localhost:port\n"
+#endif
+#ifdef CHIP8_SHARED_MEMORY
+              << "  --shm <name>     Share the screen, keypad and run control through shared memory, e.g. /chip8\n"
+#endif
+#ifdef CHIP8_NETPLAY
+              << "  --netplay-port <port>  Play with another emulator over UDP from this local port\n"
+              << "  --netplay-peer <host:port>  Address of the other player's emulator\n"
+              << "  --player <1|2>   Netplay side; player 1's seed is used [default: 1]\n"
+#endif
+              << "  --seed <n>       Seed for CXNN random numbers, for reproducible runs [default: random]\n"
+              << "  --profile        Count executions per address, subroutine and loop; print a report on exit\n"
+              << "  --headless       Run without a window\n"
+#ifdef CHIP8_TERMINAL
+              << "  --tty            Run in the terminal: block graphics, keypad from the keyboard, Ctrl-C quits\n"
+              << "  --tty-quarter    Like --tty with 2x2 pixels per character, for small terminals (monochrome)\n"
+#endif
+              << "  --frames <n>     Stop a headless run after n frames [default: unlimited]\n"
+              << "  --uncapped       Run headless frames as fast as possible instead of at 60 Hz\n"
+              << "  --record <file>  Write the screen to a Y4M video\n"
+              << "  --screenshot-every <n>  Write a PNG screenshot every n frames\n"
+              << "  --screenshot-prefix <path>  Screenshots are <path>_<frame>.png [default: ROM name]\n"
+              << "  --record-scale <n>  Video and screenshot pixels per high-resolution pixel [default: 4]\n"
+#ifdef CHIP8_ROM_WATCH
+              << "  --watch          Reload the ROM into the running machine whenever its file is saved\n"
+#endif
               << "  --help           Show this help message\n";
 }
 
@@ -42,35 +144,482 @@ EmulatorConfig parseCommandLine(int argc, char* argv[]) {
             printUsage(argv[0]);
             std::exit(0);
         } else if (arg == "--chip" && i + 1 < argc) {
-            std::string_view chipType(argv[++i]);
-            if (chipType == "superchip") {
-                config.chipType = Mode::SUPERCHIP;
-            } else if (chipType == "chip8") {
-                config.chipType = Mode::CHIP8;
-            } else {
-                throw std::runtime_error("Invalid chip type. Use 'chip8' or 'superchip'");
-            }
+            config.chipType = parseMode(argv[++i]);
         } else if (arg == "--scale" && i + 1 < argc) {
             config.scale = std::stoi(argv[++i]);
             if (config.scale < 1) {
                 throw std::runtime_error("Scale must be positive");
             }
+        } else if (arg == "--filter" && i + 1 < argc) {
+            std::optional<ScaleFilter> filter = parseScaleFilter(argv[++i]);
+            if (!filter) {
+                throw std::runtime_error("Unknown filter: " + std::string(argv[i]));
+            }
+            config.filter = *filter;
+        } else if (arg == "--phosphor" && i + 1 < argc) {
+            config.phosphor = std::stoi(argv[++i]);
+            if (config.phosphor < 0 || config.phosphor > 99) {
+                throw std::runtime_error("Phosphor persistence must be between 0 and 99");
+            }
         } else if (arg == "--disasm") {
             config.enableDisassembler = true;
+        } else if (arg == "--break" && i + 1 < argc) {
+            config.breakpoints.push_back(static_cast<uint16_t>(std::stoul(argv[++i], nullptr, 0)));
+        } else if (arg == "--watch-read" && i + 1 < argc) {
+            config.watchpoints.push_back(parseWatchpoint(argv[++i], true, false));
+        } else if (arg == "--watch-write" && i + 1 < argc) {
+            config.watchpoints.push_back(parseWatchpoint(argv[++i], false, true));
+        } else if (arg == "--break-if" && i + 1 < argc) {
+            config.conditions.push_back(RegisterCondition::parse(argv[++i]));
+        } else if (arg == "--gdb-port" && i + 1 < argc) {
+#ifdef CHIP8_GDB_STUB
+            config.gdbPort = std::stoi(argv[++i]);
+            if (config.gdbPort < 1 || config.gdbPort > 65535) {
+                throw std::runtime_error("GDB port must be between 1 and 65535");
+            }
+#else
+            throw std::runtime_error("GDB stub is not available on this platform");
+#endif
+        } else if (arg == "--shm" && i + 1 < argc) {
+#ifdef CHIP8_SHARED_MEMORY
+            config.sharedMemory = argv[++i];
+            if (config.sharedMemory.size() < 2 || config.sharedMemory[0] != '/' ||
+                config.sharedMemory.find('/', 1) != std::string::npos) {
+                throw std::runtime_error("Shared memory name must look like /name");
+            }
+#else
+            throw std::runtime_error("Shared memory is not available on this platform");
+#endif
+        } else if ((arg == "--netplay-port" || arg == "--netplay-peer" || arg == "--player") && i + 1 < argc) {
+#ifdef CHIP8_NETPLAY
+            if (arg == "--netplay-peer") {
+                config.netplayPeer = argv[++i];
+            } else if (arg == "--player") {
+                config.player = std::stoi(argv[++i]);
+                if (config.player != 1 && config.player != 2) {
+                    throw std::runtime_error("Player must be 1 or 2");
+                }
+            } else {
+                config.netplayPort = std::stoi(argv[++i]);
+                if (config.netplayPort < 1 || config.netplayPort > 65535) {
+                    throw std::runtime_error("Netplay port must be between 1 and 65535");
+                }
+            }
+#else
+            throw std::runtime_error("Netplay is not available on this platform");
+#endif
+        } else if (arg == "--seed" && i + 1 < argc) {
+            config.seed = static_cast<uint32_t>(std::stoul(argv[++i], nullptr, 0));
+        } else if (arg == "--profile") {
+            config.profile = true;
+        } else if (arg == "--headless") {
+            config.headless = true;
+        } else if (arg == "--tty" || arg == "--tty-quarter") {
+#ifdef CHIP8_TERMINAL
+            config.headless = true;
+            config.tty = true;
+            config.ttyQuarter = arg == "--tty-quarter";
+#else
+            throw std::runtime_error("The terminal frontend is not available on this platform");
+#endif
+        } else if (arg == "--frames" && i + 1 < argc) {
+            config.frames = std::stoi(argv[++i]);
+        } else if (arg == "--uncapped") {
+            config.uncapped = true;
+        } else if (arg == "--record" && i + 1 < argc) {
+            config.recordPath = argv[++i];
+        } else if (arg == "--screenshot-every" && i + 1 < argc) {
+            config.screenshotEvery = std::stoi(argv[++i]);
+            if (config.screenshotEvery < 1) {
+                throw std::runtime_error("Screenshot interval must be positive");
+            }
+        } else if (arg == "--screenshot-prefix" && i + 1 < argc) {
+            config.screenshotPrefix = argv[++i];
+        } else if (arg == "--record-scale" && i + 1 < argc) {
+            config.recordScale = std::stoi(argv[++i]);
+            if (config.recordScale < 1) {
+                throw std::runtime_error("Recording scale must be positive");
+            }
+        } else if (arg == "--watch") {
+#ifdef CHIP8_ROM_WATCH
+            config.watch = true;
+#else
+            throw std::runtime_error("ROM watching is not available on this platform");
+#endif
+        } else if (arg == "--wall") {
+            config.wall = true;
         } else if (config.romPath.empty()) {
             config.romPath = arg;
         } else {
-            throw std::runtime_error("Unexpected argument: " + std::string(arg));
+            config.wallRoms.emplace_back(arg);
         }
     }
 
+    if (!config.wall && !config.wallRoms.empty()) {
+        throw std::runtime_error("Unexpected argument: " + config.wallRoms.front());
+    }
+    if (config.wall && (config.headless || config.enableDisassembler || config.profile || config.gdbPort ||
+                        !config.sharedMemory.empty() || config.netplayPort || !config.recordPath.empty() ||
+                        config.screenshotEvery || !config.breakpoints.empty() || !config.watchpoints.empty() ||
+                        !config.conditions.empty() || config.watch)) {
+        throw std::runtime_error("The wall view only takes --chip, --scale and --seed");
+    }
+
     if (!std::filesystem::exists(config.romPath)) {
         throw std::runtime_error("ROM file not found: " + config.romPath);
     }
+    if (config.tty && (!config.breakpoints.empty() || !config.watchpoints.empty() || !config.conditions.empty())) {
+        throw std::runtime_error("The terminal frontend cannot show debugger stops; use --gdb-port");
+    }
+    if (config.watch && config.netplayPort) {
+        throw std::runtime_error("A reloaded ROM would desynchronize netplay");
+    }
+    if (config.netplayPeer.empty() != (config.netplayPort == 0)) {
+        throw std::runtime_error("Netplay needs both --netplay-port and --netplay-peer");
+    }
+    if (config.netplayPort && (!config.breakpoints.empty() || !config.watchpoints.empty() || !config.conditions.empty() ||
+                               config.gdbPort || config.profile || config.enableDisassembler)) {
+        // Rollback re-runs frames, which breakpoints and per-instruction tools cannot follow
+        throw std::runtime_error("Netplay cannot be combined with the debugger, GDB, the profiler or the disassembler");
+    }
+    if (config.screenshotPrefix.empty()) {
+        config.screenshotPrefix = std::filesystem::path(config.romPath).stem().string();
+    }
 
     return config;
 }
 
+#ifndef CHIP8_GDB_STUB
+// Placeholder so the frontends compile without the stub
+class GdbStub {
+public:
+    void service(Chip8 &, Debugger &) {}
+    void notifyStop(StopReason) {}
+    bool isHalted() const { return false; }
+    bool isConnected() const { return false; }
+    void waitForCommand(int) {}
+};
+#endif
+
+#ifndef CHIP8_SHARED_MEMORY
+// Placeholder so the frontends compile without shared memory
+class SharedHost {
+public:
+    void publish(const Display &) {}
+    void applyKeys(Chip8 &) {}
+    bool isPaused() const { return false; }
+    void setPaused(bool) {}
+    int getInstructionsPerFrame() const { return 0; }
+    uint16_t getKeys() const { return 0; }
+    void setHalted() {}
+};
+#endif
+
+#ifndef CHIP8_TERMINAL
+// Placeholder so the frontends compile without the terminal view
+struct TerminalInput {
+    uint16_t keys = 0;
+    bool pauseToggled = false;
+    bool quit = false;
+};
+
+class TerminalView {
+public:
+    void render(const Display &, bool) {}
+    TerminalInput poll() { return {}; }
+};
+#endif
+
+#ifndef CHIP8_ROM_WATCH
+// Placeholder so the frontends compile without ROM watching
+struct RomReload {
+    size_t bytes = 0;
+    size_t ranges = 0;
+    bool restored = false;
+};
+
+class RomWatcher {
+public:
+    bool changed() { return false; }
+    RomReload reload(Chip8 &) { return {}; }
+    void setCheckpoint(const Chip8 &) {}
+    bool hasCheckpoint() const { return false; }
+};
+#endif
+
+#ifndef CHIP8_NETPLAY
+// Placeholder so the frontends compile without netplay
+class NetPlay {
+public:
+    struct Stats {
+        uint64_t rollbacks = 0;
+        uint64_t resimulatedFrames = 0;
+        uint64_t stalls = 0;
+        double worstRollbackMs = 0;
+    };
+
+    bool advance(Chip8 &, uint16_t) { return true; }
+    uint32_t getFrame() const { return 0; }
+    bool isDesynced() const { return false; }
+    bool hasPeerQuit() const { return false; }
+    Stats getStats() const { return {}; }
+};
+#endif
+
+const int CYCLES_PER_FRAME = 500 / 60; // 500 Hz CPU at 60 Hz
+
+// Execute one instruction, through the debugger when it has work to do
+StopReason runCycle(Chip8 &chip8, Debugger &debugger, Profiler *profiler) {
+    uint16_t pc = chip8.getPC();
+    Instruction i{};
+    if (profiler) {
+        i = chip8.decode(chip8.peek(pc));
+    }
+    StopReason reason = StopReason::None;
+    if (debugger.isActive()) {
+        reason = debugger.run(chip8, 1);
+    } else {
+        chip8.emulateCycle();
+    }
+    // Breakpoints, watchpoints and step-over targets stop before the instruction executes
+    if (profiler && (reason == StopReason::None || reason == StopReason::Condition)) {
+        profiler->record(chip8, pc, i);
+    }
+    return reason;
+}
+
+// Apply a rewritten ROM file; a save that can't be loaded is reported and the old code keeps running
+void reloadROM(RomWatcher &watcher, Chip8 &chip8) {
+    try {
+        RomReload reload = watcher.reload(chip8);
+        std::cout << "Reloaded ROM: " << reload.bytes << " bytes changed in " << reload.ranges << " ranges"
+                  << (reload.restored ? ", back at the checkpoint" : "") << std::endl;
+    } catch (const std::exception &e) {
+        std::cout << "Reload failed: " << e.what() << std::endl;
+    }
+}
+
+void printNetPlayStats(const NetPlay &netplay) {
+    const NetPlay::Stats &stats = netplay.getStats();
+    std::cout << "Netplay: " << netplay.getFrame() << " frames, " << stats.rollbacks << " rollbacks re-simulating "
+              << stats.resimulatedFrames << " frames (longest " << stats.worstRollbackMs << " ms), "
+              << stats.stalls << " stalls" << std::endl;
+    if (netplay.isDesynced()) {
+        std::cout << "Netplay: the two machines desynchronized" << std::endl;
+    }
+}
+
+// Run without SDL at 60 frames per second; debugger stops go to GDB when a client is attached
+int runHeadless(Chip8 &chip8, Debugger &debugger, GdbStub *gdb, Profiler *profiler, FrameRecorder *recorder,
+                SharedHost *shared, NetPlay *netplay, TerminalView *tty, RomWatcher *watcher, int frames, bool uncapped) {
+    using Clock = std::chrono::steady_clock;
+    const auto frameTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0/60.0));
+    auto nextFrame = Clock::now();
+    bool paused = false; // From the terminal; shared-memory clients pause through the segment
+
+    for (int frame = 0; frames == 0 || frame < frames;) {
+        if (gdb) {
+            gdb->service(chip8, debugger);
+            if (gdb->isHalted()) {
+                gdb->waitForCommand(100);
+                nextFrame = Clock::now();
+                continue;
+            }
+        }
+
+        if (watcher && watcher->changed()) {
+            reloadROM(*watcher, chip8);
+        }
+
+        uint16_t localKeys = 0;
+        if (tty) {
+            TerminalInput input = tty->poll();
+            if (input.quit) {
+                return 0;
+            }
+            if (input.pauseToggled) {
+                paused = !paused;
+            }
+            localKeys = input.keys;
+            if (!netplay) {
+                chip8.setKeys(localKeys);
+            }
+        }
+        if (paused) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            nextFrame = Clock::now();
+            continue;
+        }
+
+        int cycles = netplay ? 0 : CYCLES_PER_FRAME;
+        if (shared) {
+            shared->applyKeys(chip8);
+            if (shared->isPaused()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                nextFrame = Clock::now();
+                continue;
+            }
+            if (int requested = shared->getInstructionsPerFrame(); requested && !netplay) {
+                cycles = requested;
+            }
+        }
+        if (!netplay) {
+            chip8.setCyclesPerSecond(cycles * 60); // A frame is one timer tick
+        }
+
+        if (netplay) {
+            // The terminal or shared-memory clients, e.g. a bot, play the local side
+            if (shared) {
+                localKeys |= shared->getKeys();
+            }
+            if (!netplay->advance(chip8, localKeys)) {
+                if (netplay->hasPeerQuit()) {
+                    std::cout << "Netplay peer quit" << std::endl;
+                    return 0;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                nextFrame = Clock::now();
+                continue;
+            }
+        } else if (!debugger.isActive() && !profiler) {
+            chip8.run(cycles); // Nothing observes single instructions, so idioms can run fused
+            cycles = 0;
+        }
+        for (int cycle = 0; cycle < cycles; cycle++) {
+            StopReason reason = runCycle(chip8, debugger, profiler);
+            if (reason == StopReason::None) {
+                continue;
+            }
+            if (gdb && gdb->isConnected()) {
+                gdb->notifyStop(reason);
+                break;
+            }
+            std::cout << debugger.getStopMessage() << std::endl;
+            printRegisters(chip8);
+            return 0;
+        }
+        if (chip8.isHalted()) {
+            if (shared) {
+                shared->setHalted();
+            }
+            return 0; // 00FD
+        }
+
+        if (!netplay) {
+            chip8.updateTimers(); // A frame cut short by a stop still ends its tick
+        }
+        if (recorder) {
+            recorder->push(chip8.display);
+        }
+        if (shared) {
+            shared->publish(chip8.display);
+        }
+        if (tty) {
+            tty->render(chip8.display, chip8.isSoundOn());
+        }
+        frame++;
+        if (!uncapped) {
+            nextFrame += frameTime;
+            std::this_thread::sleep_until(nextFrame);
+        }
+    }
+    return 0;
+}
+
+// Display upscaled on the CPU into a streaming texture; only rows the scaler redid are uploaded
+class ScreenView {
+    Scaler scaler;
+    SDL_Texture* texture = nullptr;
+    std::vector<Uint32> frame; // Scaler output, kept between frames
+    int width = 0;
+    int height = 0;
+
+public:
+    ScreenView(ScaleFilter filter, int scale, int phosphor) : scaler(filter, scale) {
+        scaler.setPersistence(static_cast<uint8_t>(phosphor * 256 / 100));
+    }
+
+    ~ScreenView() {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
+    }
+
+    ScreenView(const ScreenView&) = delete;
+    ScreenView& operator=(const ScreenView&) = delete;
+
+    void render(SDL_Renderer* renderer, const Display &display, int winWidth, int winHeight) {
+        int w = scaler.outputWidth(display);
+        int h = scaler.outputHeight(display);
+        if (w != width || h != height) {
+            // Resolution switch (00FE/00FF): the scaler redraws everything for the new size
+            if (texture) {
+                SDL_DestroyTexture(texture);
+            }
+            texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+            if (!texture) {
+                throw std::runtime_error(std::string("Screen texture error: ") + SDL_GetError());
+            }
+            width = w;
+            height = h;
+            frame.assign(static_cast<size_t>(w) * h, 0);
+        }
+
+        ScaledRows rows = scaler.render(display, frame.data(), w * sizeof(Uint32));
+        if (!rows.empty()) {
+            SDL_Rect changed = {0, rows.begin, w, rows.end - rows.begin};
+            SDL_UpdateTexture(texture, &changed, frame.data() + static_cast<size_t>(rows.begin) * w, w * sizeof(Uint32));
+        }
+        SDL_Rect target = {(winWidth - w) / 2, (winHeight - h) / 2, w, h};
+        SDL_RenderCopy(renderer, texture, nullptr, &target);
+    }
+};
+
+// Memory heatmap, one texel per address on a square grid, hotter addresses are redder
+class HeatmapOverlay {
+    SDL_Texture* texture = nullptr;
+    int side;
+    std::vector<Uint32> texels;
+
+public:
+    HeatmapOverlay(SDL_Renderer* renderer, uint32_t memorySize) : side(memorySize == 0x10000 ? 256 : 64) {
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, side, side);
+        if (!texture) {
+            throw std::runtime_error(std::string("Heatmap texture error: ") + SDL_GetError());
+        }
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        texels.resize(side * side);
+    }
+
+    ~HeatmapOverlay() {
+        SDL_DestroyTexture(texture);
+    }
+
+    HeatmapOverlay(const HeatmapOverlay&) = delete;
+    HeatmapOverlay& operator=(const HeatmapOverlay&) = delete;
+
+    void render(SDL_Renderer* renderer, const Profiler &profiler, int winWidth, int winHeight) {
+        // Logarithmic scale so loops don't wash out everything else
+        double scale = profiler.getMaxCount() ? 1.0 / std::log1p(static_cast<double>(profiler.getMaxCount())) : 0.0;
+        for (int address = 0; address < side * side; address++) {
+            uint64_t count = profiler.getCount(static_cast<uint16_t>(address));
+            if (!count) {
+                texels[address] = 0x30000000; // Unexecuted memory: faint shade
+                continue;
+            }
+            double heat = std::log1p(static_cast<double>(count)) * scale;
+            Uint32 red = static_cast<Uint32>(255 * heat);
+            Uint32 blue = 255 - red;
+            texels[address] = 0xC0000000 | red << 16 | 0x40 << 8 | blue;
+        }
+        SDL_UpdateTexture(texture, nullptr, texels.data(), side * sizeof(Uint32));
+
+        int size = std::min(winWidth, winHeight);
+        SDL_Rect target = {(winWidth - size) / 2, (winHeight - size) / 2, size, size};
+        SDL_RenderCopy(renderer, texture, nullptr, &target);
+    }
+};
+
 class SDLContext {
     SDL_Window* window;
     SDL_Renderer* renderer;
@@ -117,69 +666,434 @@ const std::map<SDL_Scancode, int> KEYMAP = {
     { SDL_SCANCODE_Z, 0xA }, { SDL_SCANCODE_X, 0x0 }, { SDL_SCANCODE_C, 0xB }, { SDL_SCANCODE_V, 0xF }
 };
 
+// Every display tiled into one streaming texture. Workers redraw the tiles whose display
+// changed; render() then uploads the band of tile rows that were touched and draws the
+// whole wall with a single copy
+class WallView {
+    static constexpr int GAP = 2; // Texels between tiles
+    static constexpr int TILE_WIDTH = Display::MAX_WIDTH; // Low resolution is doubled to fill a tile
+    static constexpr int TILE_HEIGHT = Display::MAX_HEIGHT;
+    static constexpr Uint32 PALETTE[4] = {0xFF000000, 0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555}; // As the Scaler's
+    static constexpr Uint32 BACKGROUND = 0xFF303030;
+
+    SDL_Texture* texture = nullptr;
+    int columns;
+    int rows;
+    int width; // Atlas size in texels
+    int height;
+    std::vector<Uint32> texels;
+    std::vector<uint64_t> shown; // Display hash each tile was last drawn from
+    std::vector<uint8_t> changed; // Per tile: redrawn since the last upload
+
+public:
+    WallView(size_t count) {
+        // Tiles are twice as wide as tall, so half as many columns as rows gives a square wall
+        columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(count / 2.0))));
+        rows = static_cast<int>((count + columns - 1) / columns);
+        width = columns * (TILE_WIDTH + GAP) + GAP;
+        height = rows * (TILE_HEIGHT + GAP) + GAP;
+        texels.assign(static_cast<size_t>(width) * height, BACKGROUND);
+        shown.assign(count, ~0ULL);
+        changed.assign(count, 0);
+    }
+
+    ~WallView() {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
+    }
+
+    WallView(const WallView&) = delete;
+    WallView& operator=(const WallView&) = delete;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Safe to call for different tiles at once: each writes only its own texels
+    void drawTile(size_t i, const Display &display) {
+        if (display.getHash() == shown[i]) {
+            return;
+        }
+        shown[i] = display.getHash();
+        changed[i] = 1;
+        int scale = TILE_WIDTH / display.getWidth();
+        Uint32 *origin = texels.data() + static_cast<size_t>(GAP + static_cast<int>(i) / columns * (TILE_HEIGHT + GAP)) * width +
+                         GAP + static_cast<int>(i) % columns * (TILE_WIDTH + GAP);
+        for (int y = 0; y < display.getHeight(); y++) {
+            Uint32 *row = origin + static_cast<size_t>(y) * scale * width;
+            for (int x = 0; x < display.getWidth(); x++) {
+                std::fill_n(row + x * scale, scale, PALETTE[display.getPixel(x, y)]);
+            }
+            for (int copy = 1; copy < scale; copy++) {
+                std::copy_n(row, TILE_WIDTH, row + static_cast<size_t>(copy) * width);
+            }
+        }
+    }
+
+    void render(SDL_Renderer* renderer, int winWidth, int winHeight) {
+        if (!texture) {
+            texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+            if (!texture) {
+                throw std::runtime_error(std::string("Wall texture error: ") + SDL_GetError());
+            }
+            SDL_UpdateTexture(texture, nullptr, texels.data(), width * sizeof(Uint32));
+        }
+        int first = rows;
+        int last = -1;
+        for (size_t i = 0; i < changed.size(); i++) {
+            if (changed[i]) {
+                first = std::min(first, static_cast<int>(i) / columns);
+                last = std::max(last, static_cast<int>(i) / columns);
+                changed[i] = 0;
+            }
+        }
+        if (last >= 0) {
+            SDL_Rect band = {0, first * (TILE_HEIGHT + GAP), width, (last - first + 1) * (TILE_HEIGHT + GAP) + GAP};
+            SDL_UpdateTexture(texture, &band, texels.data() + static_cast<size_t>(band.y) * width, width * sizeof(Uint32));
+        }
+
+        // Largest size that keeps the texel aspect ratio
+        double fit = std::min(static_cast<double>(winWidth) / width, static_cast<double>(winHeight) / height);
+        int w = static_cast<int>(width * fit);
+        int h = static_cast<int>(height * fit);
+        SDL_Rect target = {(winWidth - w) / 2, (winHeight - h) / 2, w, h};
+        SDL_RenderCopy(renderer, texture, nullptr, &target);
+    }
+};
+
+// ROM files named on the command line, directories expanded to the ROMs inside in name order
+std::vector<std::string> collectWallRoms(const EmulatorConfig &config) {
+    std::vector<std::string> paths;
+    std::vector<std::string> arguments = {config.romPath};
+    arguments.insert(arguments.end(), config.wallRoms.begin(), config.wallRoms.end());
+    for (const std::string &argument : arguments) {
+        if (!std::filesystem::is_directory(argument)) {
+            paths.push_back(argument);
+            continue;
+        }
+        std::vector<std::string> found;
+        for (const auto &entry : std::filesystem::directory_iterator(argument)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (entry.is_regular_file() && (extension == ".ch8" || extension == ".c8" || extension == ".sc8" ||
+                                            extension == ".xo8")) {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        paths.insert(paths.end(), found.begin(), found.end());
+    }
+    return paths;
+}
+
+// Monitor mode: every ROM in its own machine, stepped on a thread pool and drawn as one wall.
+// The keyboard drives all machines at once; Space pauses them all
+int runWall(const EmulatorConfig &config, uint32_t seed) {
+    std::vector<std::unique_ptr<Chip8>> machines;
+    for (const std::string &path : collectWallRoms(config)) {
+        if (!std::filesystem::exists(path)) {
+            throw std::runtime_error("ROM file not found: " + path);
+        }
+        machines.push_back(createMachineForROM(path, config.chipType));
+        machines.back()->setCyclesPerSecond(CYCLES_PER_FRAME * 60);
+        machines.back()->setSeed(seed + static_cast<uint32_t>(machines.size() - 1));
+    }
+    if (machines.empty()) {
+        throw std::runtime_error("No ROMs found for the wall view");
+    }
+
+    WallView wall(machines.size());
+    // Texels per window pixel: the --scale of a single machine, shrunk to fit a typical screen
+    int scale = std::max(1, std::min({config.scale, 1600 / wall.getWidth(), 1000 / wall.getHeight()}));
+    SDLContext sdl("CHIP-8 Wall", wall.getWidth() * scale, wall.getHeight() * scale, SDL_WINDOW_RESIZABLE);
+    ThreadPool pool;
+
+    using Clock = std::chrono::steady_clock;
+    const auto frameTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0/60.0));
+    auto nextFrame = Clock::now();
+    bool running = true;
+    bool paused = false;
+    size_t shownHalted = ~size_t{0};
+    SDL_Event event;
+
+    while (running) {
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                running = false;
+            } else if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+                if (event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_SPACE) {
+                    paused = !paused;
+                    shownHalted = ~size_t{0}; // Retitle
+                }
+                auto it = KEYMAP.find(event.key.keysym.scancode);
+                if (it != KEYMAP.end()) {
+                    for (auto &machine : machines) {
+                        machine->keypad[it->second] = (event.type == SDL_KEYDOWN);
+                    }
+                }
+            }
+        }
+
+        pool.parallelFor(machines.size(), [&](size_t i) {
+            Chip8 &machine = *machines[i];
+            if (!paused && !machine.isHalted()) {
+                machine.runFrame(CYCLES_PER_FRAME);
+            }
+            wall.drawTile(i, machine.display);
+        });
+
+        size_t halted = std::count_if(machines.begin(), machines.end(), [](const auto &machine) { return machine->isHalted(); });
+        if (halted != shownHalted) {
+            shownHalted = halted;
+            std::string title = "CHIP-8 Wall: " + std::to_string(machines.size()) + " machines";
+            if (halted) {
+                title += ", " + std::to_string(halted) + " halted";
+            }
+            if (paused) {
+                title += " (Paused)";
+            }
+            SDL_SetWindowTitle(sdl.getWindow(), title.c_str());
+        }
+
+        SDL_SetRenderDrawColor(sdl.getRenderer(), 0, 0, 0, 255);
+        SDL_RenderClear(sdl.getRenderer());
+        int winWidth, winHeight;
+        SDL_GetWindowSize(sdl.getWindow(), &winWidth, &winHeight);
+        wall.render(sdl.getRenderer(), winWidth, winHeight);
+        SDL_RenderPresent(sdl.getRenderer());
+
+        nextFrame += frameTime;
+        if (nextFrame < Clock::now()) {
+            nextFrame = Clock::now(); // Too many machines for real time: run as fast as possible
+        }
+        std::this_thread::sleep_until(nextFrame);
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     try {
         EmulatorConfig config = parseCommandLine(argc, argv);
         
-        // Create appropriate chip type
-        std::unique_ptr<Chip8> chip8;
-        if (config.chipType == Mode::SUPERCHIP) {
-            chip8 = std::make_unique<SuperChip>();
-        } else {
-            chip8 = std::make_unique<Chip8>();
+        uint32_t seed = config.seed ? *config.seed : std::random_device{}();
+        if (config.wall) {
+            return runWall(config, seed);
+        }
+
+        // Create the core matching the ROM (or the forced chip type)
+        std::unique_ptr<Chip8> chip8 = createMachineForROM(config.romPath, config.chipType);
+        chip8->setSeed(seed);
+
+        // Breakpoints route execution through the debugger's dispatch loop
+        Debugger debugger;
+        for (uint16_t address : config.breakpoints) {
+            debugger.addBreakpoint(address);
+        }
+        for (const Watchpoint &watchpoint : config.watchpoints) {
+            debugger.addWatchpoint(watchpoint);
+        }
+        for (const RegisterCondition &condition : config.conditions) {
+            debugger.addCondition(condition);
+        }
+
+        std::unique_ptr<Profiler> profiler;
+        if (config.profile) {
+            profiler = std::make_unique<Profiler>();
+        }
+
+        std::unique_ptr<GdbStub> gdb;
+#ifdef CHIP8_GDB_STUB
+        if (config.gdbPort) {
+            gdb = std::make_unique<GdbStub>(static_cast<uint16_t>(config.gdbPort));
+            std::cout << "Waiting for GDB on localhost:" << config.gdbPort << std::endl;
+        }
+#endif
+
+        // Encoded on a background thread; a headless run waits for the encoder rather than drop frames
+        std::unique_ptr<FrameRecorder> recorder;
+        if (!config.recordPath.empty() || config.screenshotEvery) {
+            RecorderConfig recording;
+            recording.videoPath = config.recordPath;
+            recording.screenshotEvery = config.screenshotEvery;
+            recording.screenshotPrefix = config.screenshotPrefix;
+            recording.scale = config.recordScale;
+            recording.filter = config.filter;
+            recording.persistence = static_cast<uint8_t>(config.phosphor * 256 / 100);
+            recording.lossless = config.headless;
+            recorder = std::make_unique<FrameRecorder>(recording);
+        }
+        auto finishRecording = [&] {
+            if (recorder) {
+                recorder->finish();
+                if (recorder->getDropped()) {
+                    std::cout << "Recording dropped " << recorder->getDropped() << " of "
+                              << recorder->getFrames() << " frames" << std::endl;
+                }
+            }
+        };
+
+        // Screen, keypad and run control for other processes
+        std::unique_ptr<SharedHost> shared;
+#ifdef CHIP8_SHARED_MEMORY
+        if (!config.sharedMemory.empty()) {
+            shared = std::make_unique<SharedHost>(config.sharedMemory);
+        }
+#endif
+
+        // Two-player session; both machines must start from the same seed
+        std::unique_ptr<NetPlay> netplay;
+#ifdef CHIP8_NETPLAY
+        if (config.netplayPort) {
+            NetPlayConfig session;
+            session.port = static_cast<uint16_t>(config.netplayPort);
+            session.peer = config.netplayPeer;
+            session.player = config.player;
+            session.seed = seed;
+            session.instructionsPerFrame = CYCLES_PER_FRAME;
+            chip8->setCyclesPerSecond(CYCLES_PER_FRAME * 60); // Both peers tick once per frame
+            std::vector<uint8_t> rom = readROMFile(config.romPath);
+            netplay = std::make_unique<NetPlay>(session, hashROM(rom.data(), rom.size()));
+            std::cout << "Waiting for player " << 3 - config.player << " at " << config.netplayPeer << std::endl;
+            chip8->setSeed(netplay->connect(*chip8));
+        }
+#endif
+
+        // Edit-and-test loop: saves of the ROM go straight into the running machine
+        std::unique_ptr<RomWatcher> watcher;
+#ifdef CHIP8_ROM_WATCH
+        if (config.watch) {
+            watcher = std::make_unique<RomWatcher>(config.romPath);
+        }
+#endif
+
+        if (config.headless) {
+            std::unique_ptr<TerminalView> tty;
+#ifdef CHIP8_TERMINAL
+            if (config.tty) {
+                tty = std::make_unique<TerminalView>(config.ttyQuarter ? TerminalBlocks::Quarter : TerminalBlocks::Half);
+            }
+#endif
+            int status = runHeadless(*chip8, debugger, gdb.get(), profiler.get(), recorder.get(), shared.get(),
+                                     netplay.get(), tty.get(), watcher.get(), config.frames, config.uncapped);
+            tty.reset(); // Back to the normal screen before printing reports
+            finishRecording();
+            if (netplay) {
+                printNetPlayStats(*netplay);
+            }
+            if (profiler) {
+                std::cout << profiler->report(*chip8);
+            }
+            return status;
         }
         
-        chip8->setMode(config.chipType);
-        chip8->loadROM(config.romPath);
-        
-        // Initialize SDL with RAII
-        SDLContext sdl("CHIP-8 Emulator", 
-                      chip8->display.getWidth() * config.scale,
-                      chip8->display.getHeight() * config.scale,
-                      SDL_WINDOW_RESIZABLE);
+        // SDL and the window come up at the first displayed frame (openWindow below), so the
+        // ROM starts executing without waiting tens of milliseconds for the video driver
+        std::unique_ptr<SDLContext> sdl;
         
-        // Pre-allocate pixels array
-        std::vector<SDL_Rect> pixels(chip8->display.getWidth() * chip8->display.getHeight());
+        ScreenView screen(config.filter, config.scale, config.phosphor);
         
         // Setup timing
         using Clock = std::chrono::high_resolution_clock;
         using Duration = std::chrono::duration<double>;
         
         const Duration frameTime(1.0/60.0);  // 60 Hz
-        const Duration cpuCycleTime(1.0/500.0);  // 500 Hz
+        const int defaultFrequency = 500; // 500 Hz
+        int cpuFrequency = defaultFrequency; // Shared memory clients can set instructions per frame
+        Duration cpuCycleTime(1.0 / cpuFrequency);
+        if (!netplay) {
+            chip8->setCyclesPerSecond(cpuFrequency); // Timers follow executed cycles, not the host clock
+        }
         
         auto lastFrameTime = Clock::now();
         auto lastCpuTime = Clock::now();
         
-        // Create disassembly window if enabled
+        // Calculate window dimensions
+        const int mainWidth = chip8->display.getWidth() * config.scale;
+        const int mainHeight = chip8->display.getHeight() * config.scale;
+        const int disasmWidth = 420;  // Fixed width for disassembly
+
+        // Create disassembly window if enabled; it opens itself once SDL is up
         std::unique_ptr<DisassemblyWindow> disasmWindow;
         if (config.enableDisassembler) {
-            // Calculate window dimensions and positions
-            int mainWidth = chip8->display.getWidth() * config.scale;
-            int mainHeight = chip8->display.getHeight() * config.scale;
-            
-            // Position main window slightly to the right of center
-            SDL_SetWindowPosition(sdl.getWindow(), 
-                                SDL_WINDOWPOS_CENTERED + mainWidth/4, 
-                                SDL_WINDOWPOS_CENTERED);
-            
-            // Create disassembly window (vertical rectangle on the left)
+            // Vertical rectangle on the left
             disasmWindow = std::make_unique<DisassemblyWindow>(
                 "CHIP-8 Disassembly",
-                SDL_WINDOWPOS_CENTERED - mainWidth/4 - 300,  // Left of main window
+                SDL_WINDOWPOS_CENTERED - mainWidth/4 - disasmWidth,  // Left of main window
                 SDL_WINDOWPOS_CENTERED,  // Same vertical position
-                300,  // Fixed width for disassembly
+                disasmWidth,
                 mainHeight  // Match main window height
             );
         }
 
+        // Heatmap overlay of executed memory, toggled with H while profiling
+        std::unique_ptr<HeatmapOverlay> heatmap;
+        bool showHeatmap = false;
+
+        auto openWindow = [&]() {
+            // Initialize SDL with RAII
+            sdl = std::make_unique<SDLContext>("CHIP-8 Emulator", mainWidth, mainHeight, SDL_WINDOW_RESIZABLE);
+            if (disasmWindow) {
+                // Position main window slightly to the right of center
+                SDL_SetWindowPosition(sdl->getWindow(), 
+                                    SDL_WINDOWPOS_CENTERED + mainWidth/4, 
+                                    SDL_WINDOWPOS_CENTERED);
+            }
+            if (profiler) {
+                heatmap = std::make_unique<HeatmapOverlay>(sdl->getRenderer(), chip8->memorySize());
+            }
+        };
+
         bool running = true;
         bool paused = false;
+        uint16_t localKeys = 0; // Netplay: this player's keys, applied by NetPlay::advance()
         SDL_Event event;
+
+        auto setPaused = [&](bool value) {
+            paused = value;
+            if (shared) {
+                shared->setPaused(paused);
+            }
+            // Update window title to show pause state
+            std::string title = "CHIP-8 Emulator";
+            if (paused) {
+                title += " (Paused)";
+            }
+            if (sdl) {
+                SDL_SetWindowTitle(sdl->getWindow(), title.c_str());
+            }
+        };
+        auto reportStop = [&](StopReason reason) {
+            if (gdb && gdb->isConnected()) {
+                gdb->notifyStop(reason); // The GDB client decides when to resume
+            } else if (reason != StopReason::None) {
+                setPaused(true);
+                std::cout << debugger.getStopMessage() << std::endl;
+                printRegisters(*chip8);
+            }
+        };
         
         while (running) {
+            if (gdb) {
+                gdb->service(*chip8, debugger);
+            }
+            if (watcher && watcher->changed()) {
+                reloadROM(*watcher, *chip8);
+            }
+            if (shared) {
+                shared->applyKeys(*chip8);
+                if (shared->isPaused() != paused) {
+                    setPaused(shared->isPaused());
+                }
+                int instructions = shared->getInstructionsPerFrame();
+                cpuFrequency = instructions ? 60 * instructions : defaultFrequency;
+                cpuCycleTime = Duration(1.0 / cpuFrequency);
+                if (!netplay) {
+                    chip8->setCyclesPerSecond(cpuFrequency);
+                }
+            }
+
             // Handle events
-            while (SDL_PollEvent(&event)) {
+            while (sdl && SDL_PollEvent(&event)) {
                 // Check for main window close
                 if (event.type == SDL_QUIT) {
                     running = false;
@@ -188,7 +1102,7 @@ int main(int argc, char* argv[]) {
                 
                 // Check for any window close events
                 if (event.type == SDL_WINDOWEVENT) {
-                    Uint32 mainWindowID = SDL_GetWindowID(sdl.getWindow());
+                    Uint32 mainWindowID = SDL_GetWindowID(sdl->getWindow());
                     if (event.window.windowID == mainWindowID && 
                         event.window.event == SDL_WINDOWEVENT_CLOSE) {
                         running = false;
@@ -204,19 +1118,36 @@ int main(int argc, char* argv[]) {
                 }
                 else if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
                     // Handle pause state with KEYDOWN only
-                    if (event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_SPACE) {
-                        paused = !paused;  // Toggle pause state
-                        // Update window title to show pause state
-                        std::string title = "CHIP-8 Emulator";
-                        if (paused) {
-                            title += " (Paused)";
+                    if (event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_SPACE && !netplay) {
+                        setPaused(!paused);  // Toggle pause state
+                    }
+                    // F5 marks the state that ROM reloads return to
+                    if (event.type == SDL_KEYDOWN && watcher && event.key.keysym.scancode == SDL_SCANCODE_F5) {
+                        watcher->setCheckpoint(*chip8);
+                        std::cout << "Checkpoint saved, ROM reloads resume from here" << std::endl;
+                    }
+                    if (event.type == SDL_KEYDOWN && heatmap && event.key.keysym.scancode == SDL_SCANCODE_H) {
+                        showHeatmap = !showHeatmap;
+                    }
+                    // Single step (F11) and step over calls (F10) while paused
+                    if (event.type == SDL_KEYDOWN && paused && event.key.keysym.scancode == SDL_SCANCODE_F11) {
+                        reportStop(debugger.step(*chip8));
+                    }
+                    if (event.type == SDL_KEYDOWN && paused && event.key.keysym.scancode == SDL_SCANCODE_F10) {
+                        StopReason reason = debugger.stepOver(*chip8);
+                        if (reason == StopReason::None) {
+                            setPaused(false); // Run the call, the debugger stops when it returns
+                        } else {
+                            reportStop(reason);
                         }
-                        SDL_SetWindowTitle(sdl.getWindow(), title.c_str());
                     }
                     
                     // Handle regular keypad input for both KEYDOWN and KEYUP
                     auto it = KEYMAP.find(event.key.keysym.scancode);
-                    if (it != KEYMAP.end()) {
+                    if (it != KEYMAP.end() && netplay) {
+                        uint16_t bit = static_cast<uint16_t>(1 << it->second);
+                        localKeys = event.type == SDL_KEYDOWN ? localKeys | bit : localKeys & ~bit;
+                    } else if (it != KEYMAP.end()) {
                         chip8->keypad[it->second] = (event.type == SDL_KEYDOWN);
                     }
                 }
@@ -225,66 +1156,92 @@ int main(int argc, char* argv[]) {
             // Run CPU cycles and handle timing
             auto now = Clock::now();
             
+            // Netplay runs whole frames in lockstep with the peer; a frame that has to wait is retried
+            while (netplay && now - lastCpuTime >= frameTime) {
+                if (!netplay->advance(*chip8, localKeys)) {
+                    lastCpuTime = now;
+                    break;
+                }
+                lastCpuTime += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frameTime);
+            }
+            if (netplay && netplay->hasPeerQuit()) {
+                std::cout << "Netplay peer quit" << std::endl;
+                running = false;
+            }
+
             // Always update CPU cycle timing
-            while (now - lastCpuTime >= cpuCycleTime) {
+            while (!netplay && now - lastCpuTime >= cpuCycleTime) {
                 // Only execute instructions if not paused
-                if (!paused) {
+                if (!paused && !(gdb && gdb->isHalted())) {
+                    uint16_t pc = chip8->getPC();
+                    std::string disasm;
                     if (config.enableDisassembler) {
-                        uint16_t opcode = chip8->fetch();
-                        auto instruction = chip8->decode(opcode);
-                        std::string disasm = chip8->disassemble(instruction);
+                        disasm = chip8->disassemble(chip8->decode(chip8->peek(pc)));
+                    }
+                    StopReason reason = runCycle(*chip8, debugger, profiler.get());
+                    // Breakpoints and watchpoints stop before the instruction executes
+                    if (config.enableDisassembler && reason != StopReason::Breakpoint && reason != StopReason::Watchpoint) {
+                        if (profiler) {
+                            // Hit count of the address instead of a bare line number
+                            disasm = "[" + std::to_string(profiler->getCount(pc)) + "] " + disasm;
+                        }
                         disasmWindow->addInstruction(disasm);
                         disasmWindow->render();
-                        chip8->execute(instruction);
-                    } else {
-                        chip8->emulateCycle();
                     }
+                    reportStop(reason);
                 }
                 lastCpuTime += std::chrono::duration_cast<std::chrono::steady_clock::duration>(cpuCycleTime);
             }
+            if (chip8->isHalted()) {
+                if (shared) {
+                    shared->setHalted();
+                }
+                std::cout << "0x00FD, Exiting..." << std::endl;
+                running = false;
+            }
             
             // Update display if needed
             auto currentTime = Clock::now();
             Duration elapsed = currentTime - lastFrameTime;
             
             if (elapsed >= frameTime) {
-                chip8->updateTimers();
                 lastFrameTime = currentTime;
+                if (recorder) {
+                    recorder->push(chip8->display);
+                }
+                if (shared) {
+                    shared->publish(chip8->display);
+                }
+                
+                if (!sdl) {
+                    openWindow();
+                }
                 
                 // Clear renderer
-                SDL_SetRenderDrawColor(sdl.getRenderer(), 0, 0, 0, 255);
-                SDL_RenderClear(sdl.getRenderer());
+                SDL_SetRenderDrawColor(sdl->getRenderer(), 0, 0, 0, 255);
+                SDL_RenderClear(sdl->getRenderer());
                 
                 // Get window size for centering
                 int winWidth, winHeight;
-                SDL_GetWindowSize(sdl.getWindow(), &winWidth, &winHeight);
+                SDL_GetWindowSize(sdl->getWindow(), &winWidth, &winHeight);
                 
-                // Update pixels
-                int pixelCount = 0;
-                for (int x = 0; x < chip8->display.getWidth(); ++x) {
-                    for (int y = 0; y < chip8->display.getHeight(); ++y) {
-                        if (chip8->display.display[y * chip8->display.getWidth() + x]) {
-                            int xOffset = (winWidth - chip8->display.getWidth() * config.scale) / 2;
-                            int yOffset = (winHeight - chip8->display.getHeight() * config.scale) / 2;
-                            pixels[pixelCount++] = {
-                                xOffset + x * config.scale,
-                                yOffset + y * config.scale,
-                                config.scale,
-                                config.scale
-                            };
-                        }
-                    }
-                }
+                screen.render(sdl->getRenderer(), chip8->display, winWidth, winHeight);
                 
-                // Draw pixels
-                if (pixelCount > 0) {
-                    SDL_SetRenderDrawColor(sdl.getRenderer(), 255, 255, 255, 255);
-                    SDL_RenderFillRects(sdl.getRenderer(), pixels.data(), pixelCount);
+                if (showHeatmap) {
+                    heatmap->render(sdl->getRenderer(), *profiler, winWidth, winHeight);
                 }
                 
-                SDL_RenderPresent(sdl.getRenderer());
+                SDL_RenderPresent(sdl->getRenderer());
             }
         }
+
+        finishRecording();
+        if (profiler) {
+            std::cout << profiler->report(*chip8);
+        }
+        if (netplay) {
+            printNetPlayStats(*netplay);
+        }
         
         return 0;
     }
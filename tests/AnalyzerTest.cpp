@@ -0,0 +1,96 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "Analyzer.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char *what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+Analysis analyze(const std::vector<uint8_t> &rom) {
+    return analyzeROM(rom.data(), rom.size(), Mode::CHIP8);
+}
+
+// Stores to a constant I outside the code leave every block precompilable
+void storeToKnownAddress() {
+    Analysis analysis = analyze({
+        0xA3, 0x00, // 200: I := 0x300
+        0xF0, 0x55, // 202: store V0 to V0
+        0x12, 0x04  // 204: jump 0x204
+    });
+    check(analysis.unknownWrites.empty(), "known store: no unknown writes");
+    check(analysis.selfModifyingWrites.empty(), "known store: no self-modifying writes");
+    check(analysis.isPrecompilable(0x200), "known store: 0x200 precompilable");
+    check(analysis.isPrecompilable(0x204), "known store: 0x204 precompilable");
+}
+
+// FX55 through a computed I may write into any block, so none can be precompiled
+void storeThroughComputedIndex() {
+    Analysis analysis = analyze({
+        0xA3, 0x00, // 200: I := 0x300
+        0xF0, 0x1E, // 202: I += V0
+        0xF0, 0x55, // 204: store V0 to V0
+        0x12, 0x06  // 206: jump 0x206
+    });
+    check(analysis.unknownWrites == std::vector<uint16_t>{0x204}, "computed I: store at 0x204 is unknown");
+    check(analysis.selfModifyingWrites.empty(), "computed I: no known self-modifying writes");
+    check(!analysis.blocks.empty(), "computed I: blocks found");
+    for (const auto &[start, block] : analysis.blocks) {
+        check(!block.precompilable, "computed I: no block precompilable");
+    }
+    check(!analysis.isPrecompilable(0x200), "computed I: 0x200 not precompilable");
+    check(!analysis.isPrecompilable(0x206), "computed I: 0x206 not precompilable");
+}
+
+// A store into the ROM's own code marks the block it hits
+void storeIntoCode() {
+    Analysis analysis = analyze({
+        0xA2, 0x06, // 200: I := 0x206
+        0xF0, 0x55, // 202: store V0 to V0
+        0x12, 0x06, // 204: jump 0x206
+        0x12, 0x06  // 206: jump 0x206
+    });
+    check(analysis.selfModifyingWrites.size() == 1, "code store: one self-modifying write");
+    check(analysis.isPrecompilable(0x200), "code store: 0x200 precompilable");
+    check(!analysis.isPrecompilable(0x206), "code store: 0x206 not precompilable");
+}
+
+// Straight-line code up to the last word of XO-CHIP memory ends there instead of wrapping to 0
+void codeRunsToEndOfMemory() {
+    std::vector<uint8_t> rom;
+    for (int k = 0; k < 0xFE00 / 2; k++) {
+        rom.insert(rom.end(), {0x60, 0x00}); // V0 := 0
+    }
+    Analysis analysis = analyzeROM(rom.data(), rom.size(), Mode::XOCHIP);
+    check(analysis.blocks.size() == 1, "end of memory: one block");
+    check(!analysis.blocks.empty() && analysis.blocks.begin()->second.end == 0x10000, "end of memory: block ends at 0x10000");
+    check(!analysis.blocks.empty() && analysis.blocks.begin()->second.successors.empty(), "end of memory: no successor");
+    check(analysis.isCode(0xFFFE), "end of memory: 0xFFFE is code");
+    check(!analysis.isCode(0x0000), "end of memory: 0x0000 is not code");
+}
+
+}
+
+int main() {
+    storeToKnownAddress();
+    storeThroughComputedIndex();
+    storeIntoCode();
+    codeRunsToEndOfMemory();
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All analyzer checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,94 @@
+//
+// Created by Alessandro Vacca on 06/04/25.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "VectorEnv.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char *what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+// Waits for key 0, then draws the font glyph "0" at (0, 0) and spins
+const std::vector<uint8_t> ROM = {
+    0x60, 0x00, // 200: V0 := 0x00
+    0xE0, 0x9E, // 202: skip if key V0 pressed
+    0x12, 0x02, // 204: jump 0x202
+    0xF0, 0x29, // 206: I := addr sprite V0
+    0xD0, 0x05, // 208: draw (V0, V0), height 5
+    0x12, 0x0A  // 20A: jump 0x20A
+};
+
+constexpr size_t COUNT = 8;
+
+// First framebuffer word of instance i, found by stride arithmetic from instance 0 alone,
+// the way a zero-copy batch view indexes the arena
+uint64_t firstWord(const VectorEnv &env, size_t i) {
+    const auto *base = reinterpret_cast<const std::byte *>(&env.machine(0).display.planes[0][0][0]);
+    return *reinterpret_cast<const uint64_t *>(base + i * env.stride());
+}
+
+void layout(const VectorEnv &env) {
+    check(env.size() == COUNT, "one machine per instance");
+    check(env.stride() % CACHE_LINE_SIZE == 0, "stride is a whole number of cache lines");
+    check(env.stride() >= sizeof(Chip8), "stride covers a machine");
+    // Shape (N, PLANES, MAX_HEIGHT, WORDS) of uint64: the inner dimensions are dense
+    const Display &display = env.machine(0).display;
+    check(sizeof(display.planes) == sizeof(uint64_t) * Display::PLANES * Display::MAX_HEIGHT * Display::WORDS,
+          "framebuffer is dense");
+    for (size_t i = 0; i < env.size(); i++) {
+        const auto *first = reinterpret_cast<const std::byte *>(&env.machine(0).display.planes);
+        const auto *planes = reinterpret_cast<const std::byte *>(&env.machine(i).display.planes);
+        check(static_cast<size_t>(planes - first) == i * env.stride(), "framebuffers are stride() bytes apart");
+    }
+}
+
+}
+
+int main() {
+    VectorEnv env(ROM, Mode::CHIP8, COUNT, 4, 8, 2);
+    layout(env);
+
+    env.reset(1);
+    for (size_t i = 0; i < env.size(); i++) {
+        check(firstWord(env, i) == 0, "reset: screen blank");
+        check(env.machine(i).getPC() == 0x200, "reset: at 0x200");
+    }
+
+    // Even instances hold key 0, odd ones press nothing
+    std::vector<uint16_t> actions(env.size());
+    for (size_t i = 0; i < env.size(); i += 2) {
+        actions[i] = 1 << 0x0;
+    }
+    env.step(actions.data());
+    const uint64_t glyphRow = uint64_t{0xF0} << 56; // Top row of "0", leftmost pixel in the top bit
+    for (size_t i = 0; i < env.size(); i++) {
+        check(!env.getDone()[i], "step: no instance halted");
+        check(firstWord(env, i) == (i % 2 == 0 ? glyphRow : 0), "step: strided view sees each instance's screen");
+    }
+    layout(env);
+
+    // A restored snapshot brings the screen back
+    std::unique_ptr<Chip8> drawn = env.snapshot(0);
+    env.reset(1);
+    check(firstWord(env, 0) == 0, "reset after step: screen blank");
+    env.restore(0, *drawn);
+    check(firstWord(env, 0) == glyphRow, "restore: screen back");
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All vector environment checks passed" << std::endl;
+    return 0;
+}